@@ -425,8 +425,9 @@ struct H3DNodeTypes
 		Mesh       - Subgroup of a model with triangles of one material
 		Joint      - Joint for skeletal animation
 		Light      - Light source
-		Camera     - Camera giving view on scene
-		Emitter    - Particle system emitter
+		Camera         - Camera giving view on scene
+		Emitter        - Particle system emitter
+		InstancedMesh  - Triangles of one material drawn many times with per-instance transformations
 	*/
 	enum List
 	{
@@ -437,7 +438,8 @@ struct H3DNodeTypes
 		Joint,
 		Light,
 		Camera,
-		Emitter
+		Emitter,
+		InstancedMesh
 	};
 };
 
@@ -641,6 +643,32 @@ struct H3DEmitter
 	};
 };
 
+struct H3DInstancedMesh
+{
+	/*	Enum: H3DInstancedMesh
+			The available InstancedMesh node parameters.
+		
+		GeoResI         - Geometry resource used for the instances
+		MatResI         - Material resource used for the instances
+		BatchStartI     - First triangle index of mesh in Geometry resource [read-only]
+		BatchCountI     - Number of triangle indices used for drawing one instance [read-only]
+		VertRStartI     - First vertex in Geometry resource [read-only]
+		VertREndI       - Last vertex in Geometry resource [read-only]
+		InstanceCountI  - Number of instances; added instances are collapsed to a point and not
+		                  drawn until their transformation is set (default: 0)
+	*/
+	enum List
+	{
+		GeoResI = 800,
+		MatResI,
+		BatchStartI,
+		BatchCountI,
+		VertRStartI,
+		VertREndI,
+		InstanceCountI
+	};
+};
+
 
 /* Group: Basic functions */
 /* Function: h3dGetVersionString
@@ -1574,6 +1602,24 @@ DLL void h3dGetNodeTransMats( H3DNode node, const float **relMat, const float **
 */
 DLL void h3dSetNodeTransMat( H3DNode node, const float *mat4x4 );
 
+/* Function: h3dSetNodeTransMats
+		Sets the relative transformation matrices of several nodes at once.
+	
+	Details:
+		This function sets the relative transformation matrices of an array of scene nodes. It is the
+		same as calling setNodeTransMat for every node but saves the overhead of one API call per node
+		when many nodes are moved at the same time. Invalid node handles are reported and skipped.
+	
+	Parameters:
+		nodes   - pointer to an array of handles to the nodes which will be modified
+		mats4x4 - pointer to an array of 4x4 matrices in column major order, one for each node
+		count   - number of nodes in the array
+		
+	Returns:
+		nothing
+*/
+DLL void h3dSetNodeTransMats( const H3DNode *nodes, const float *mats4x4, int count );
+
 /* Function: h3dGetNodeParamI
 		Gets a property of a scene node.
 	
@@ -2113,3 +2159,52 @@ DLL void h3dAdvanceEmitterTime( H3DNode emitterNode, float timeDelta );
 		true if Emitter will no more emit any particles, otherwise or in case of failure false
 */
 DLL bool h3dHasEmitterFinished( H3DNode emitterNode );
+
+
+/* Group: InstancedMesh-specific scene graph functions */
+/* Function: h3dAddInstancedMeshNode
+		Adds an InstancedMesh node to the scene.
+	
+	Details:
+		This function creates a new InstancedMesh node and attaches it to the specified parent node.
+		An InstancedMesh node draws the same triangles many times, each instance with its own
+		transformation relative to the node. The node is culled as a whole and its instances are
+		drawn with as few draw calls as the hardware allows. The material's shader gets the first
+		three rows of the instance transformations in the uniform array instMatRows; if the shader
+		has no such array, every instance is drawn on its own with its world transformation.
+	
+	Parameters:
+		parent       - handle to parent node to which the new node will be attached
+		name         - name of the node
+		geometryRes  - Geometry resource used by InstancedMesh node
+		materialRes  - material resource used by InstancedMesh node
+		batchStart   - first triangle index of mesh in Geometry resource
+		batchCount   - number of triangle indices used for drawing one instance
+		vertRStart   - first vertex in Geometry resource
+		vertREnd     - last vertex in Geometry resource
+		
+	Returns:
+		handle to the created node or 0 in case of failure
+*/
+DLL H3DNode h3dAddInstancedMeshNode( H3DNode parent, const char *name, H3DRes geometryRes, H3DRes materialRes,
+                                     int batchStart, int batchCount, int vertRStart, int vertREnd );
+
+/* Function: h3dSetInstanceTransMats
+		Sets the transformation matrices of instances of an InstancedMesh node.
+	
+	Details:
+		This function sets the transformations of the specified instances relative to their InstancedMesh
+		node. Only the first three rows of the matrices are used, so projections are not possible. An
+		instance with a zero matrix is collapsed to a point and skipped where possible. Indices outside
+		the instance count of the node are reported and skipped.
+	
+	Parameters:
+		instMeshNode  - handle to the InstancedMesh node which will be modified
+		instances     - pointer to an array of instance indices
+		mats4x4       - pointer to an array of 4x4 matrices in column major order, one for each index
+		count         - number of instances in the arrays
+		
+	Returns:
+		nothing
+*/
+DLL void h3dSetInstanceTransMats( H3DNode instMeshNode, const int *instances, const float *mats4x4, int count );
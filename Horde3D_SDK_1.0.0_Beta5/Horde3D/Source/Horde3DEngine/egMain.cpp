@@ -567,6 +567,32 @@ DLLEXP void h3dSetNodeTransMat( NodeHandle node, const float *mat4x4 )
 }
 
 
+DLLEXP void h3dSetNodeTransMats( const NodeHandle *nodes, const float *mats4x4, int count )
+{
+	static Matrix4f mat;
+	
+	if( count <= 0 ) return;
+	if( nodes == 0x0 || mats4x4 == 0x0 )
+	{	
+		Modules::setError( "Invalid pointer in h3dSetNodeTransMats" );
+		return;
+	}
+
+	for( int i = 0; i < count; ++i )
+	{
+		SceneNode *sn = Modules::sceneMan().resolveNodeHandle( nodes[i] );
+		if( sn == 0x0 )
+		{
+			Modules::setError( "Invalid node handle in ", "h3dSetNodeTransMats" );
+			continue;
+		}
+
+		memcpy( mat.c, mats4x4 + i * 16, 16 * sizeof( float ) );
+		sn->setTransform( mat );
+	}
+}
+
+
 DLLEXP int h3dGetNodeParamI( NodeHandle node, int param )
 {
 	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( node );
@@ -895,6 +921,42 @@ DLLEXP bool h3dHasEmitterFinished( NodeHandle emitterNode )
 }
 
 
+DLLEXP NodeHandle h3dAddInstancedMeshNode( NodeHandle parent, const char *name, ResHandle geometryRes,
+                                           ResHandle materialRes, int batchStart, int batchCount,
+                                           int vertRStart, int vertREnd )
+{
+	SceneNode *parentNode = Modules::sceneMan().resolveNodeHandle( parent );
+	APIFUNC_VALIDATE_NODE( parentNode, "h3dAddInstancedMeshNode", 0 );
+	Resource *geoRes = Modules::resMan().resolveResHandle( geometryRes );
+	APIFUNC_VALIDATE_RES_TYPE( geoRes, ResourceTypes::Geometry, "h3dAddInstancedMeshNode", 0 );
+	Resource *matRes = Modules::resMan().resolveResHandle( materialRes );
+	APIFUNC_VALIDATE_RES_TYPE( matRes, ResourceTypes::Material, "h3dAddInstancedMeshNode", 0 );
+
+	//Modules::log().writeInfo( "Adding InstancedMesh node '%s'", safeStr( name ).c_str() );
+	InstancedMeshNodeTpl tpl( safeStr( name, 0 ), (GeometryResource *)geoRes, (MaterialResource *)matRes,
+	                          (unsigned)batchStart, (unsigned)batchCount, (unsigned)vertRStart, (unsigned)vertREnd );
+	SceneNode *sn = Modules::sceneMan().findType( SceneNodeTypes::InstancedMesh )->factoryFunc( tpl );
+	return Modules::sceneMan().addNode( sn, *parentNode );
+}
+
+
+DLLEXP void h3dSetInstanceTransMats( NodeHandle instMeshNode, const int *instances, const float *mats4x4,
+                                     int count )
+{
+	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( instMeshNode );
+	APIFUNC_VALIDATE_NODE_TYPE( sn, SceneNodeTypes::InstancedMesh, "h3dSetInstanceTransMats", APIFUNC_RET_VOID );
+	if( count <= 0 ) return;
+	if( instances == 0x0 || mats4x4 == 0x0 )
+	{
+		Modules::setError( "Invalid pointer in h3dSetInstanceTransMats" );
+		return;
+	}
+	
+	if( !((InstancedMeshNode *)sn)->setInstanceTransMats( instances, mats4x4, count ) )
+		Modules::setError( "Invalid instance index in h3dSetInstanceTransMats" );
+}
+
+
 // =================================================================================================
 // DLL entry point
 // =================================================================================================
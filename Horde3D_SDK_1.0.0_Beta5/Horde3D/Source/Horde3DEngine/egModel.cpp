@@ -519,4 +519,267 @@ void ModelNode::onFinishedUpdate()
 	updateGeometry();
 }
 
+
+// *************************************************************************************************
+// Class InstancedMeshNode
+// *************************************************************************************************
+
+InstancedMeshNode::InstancedMeshNode( const InstancedMeshNodeTpl &instMeshTpl ) :
+	SceneNode( instMeshTpl ), _geometryRes( instMeshTpl.geoRes ), _materialRes( instMeshTpl.matRes ),
+	_batchStart( instMeshTpl.batchStart ), _batchCount( instMeshTpl.batchCount ),
+	_vertRStart( instMeshTpl.vertRStart ), _vertREnd( instMeshTpl.vertREnd )
+{
+	_renderable = true;
+	if( _materialRes != 0x0 )
+		_sortKey = (float)_materialRes->getHandle();
+	
+	updateLocalAABB();
+	setInstanceCount( instMeshTpl.instanceCount );
+}
+
+
+InstancedMeshNode::~InstancedMeshNode()
+{
+	_geometryRes = 0x0;
+	_materialRes = 0x0;
+}
+
+
+SceneNodeTpl *InstancedMeshNode::parsingFunc( map< string, string > &attribs )
+{
+	bool result = true;
+	
+	map< string, string >::iterator itr;
+	InstancedMeshNodeTpl *instMeshTpl = new InstancedMeshNodeTpl( "", 0x0, 0x0, 0, 0, 0, 0 );
+
+	itr = attribs.find( "geometry" );
+	if( itr != attribs.end() )
+	{
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Geometry, itr->second, 0, false );
+		if( res != 0 )
+			instMeshTpl->geoRes = (GeometryResource *)Modules::resMan().resolveResHandle( res );
+	}
+	else result = false;
+	itr = attribs.find( "material" );
+	if( itr != attribs.end() )
+	{
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		if( res != 0 )
+			instMeshTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
+	}
+	else result = false;
+	itr = attribs.find( "batchStart" );
+	if( itr != attribs.end() ) instMeshTpl->batchStart = atoi( itr->second.c_str() );
+	else result = false;
+	itr = attribs.find( "batchCount" );
+	if( itr != attribs.end() ) instMeshTpl->batchCount = atoi( itr->second.c_str() );
+	else result = false;
+	itr = attribs.find( "vertRStart" );
+	if( itr != attribs.end() ) instMeshTpl->vertRStart = atoi( itr->second.c_str() );
+	else result = false;
+	itr = attribs.find( "vertREnd" );
+	if( itr != attribs.end() ) instMeshTpl->vertREnd = atoi( itr->second.c_str() );
+	else result = false;
+
+	itr = attribs.find( "instanceCount" );
+	if( itr != attribs.end() ) instMeshTpl->instanceCount = atoi( itr->second.c_str() );
+
+	if( !result )
+	{
+		delete instMeshTpl; instMeshTpl = 0x0;
+	}
+	
+	return instMeshTpl;
+}
+
+
+SceneNode *InstancedMeshNode::factoryFunc( const SceneNodeTpl &nodeTpl )
+{
+	if( nodeTpl.type != SceneNodeTypes::InstancedMesh ) return 0x0;
+	
+	return new InstancedMeshNode( *(InstancedMeshNodeTpl *)&nodeTpl );
+}
+
+
+int InstancedMeshNode::getParamI( int param )
+{
+	switch( param )
+	{
+	case InstancedMeshNodeParams::GeoResI:
+		return _geometryRes != 0x0 ? _geometryRes->getHandle() : 0;
+	case InstancedMeshNodeParams::MatResI:
+		return _materialRes != 0x0 ? _materialRes->getHandle() : 0;
+	case InstancedMeshNodeParams::BatchStartI:
+		return _batchStart;
+	case InstancedMeshNodeParams::BatchCountI:
+		return _batchCount;
+	case InstancedMeshNodeParams::VertRStartI:
+		return _vertRStart;
+	case InstancedMeshNodeParams::VertREndI:
+		return _vertREnd;
+	case InstancedMeshNodeParams::InstanceCountI:
+		return (int)getInstanceCount();
+	}
+
+	return SceneNode::getParamI( param );
+}
+
+
+void InstancedMeshNode::setParamI( int param, int value )
+{
+	Resource *res;
+	
+	switch( param )
+	{
+	case InstancedMeshNodeParams::GeoResI:
+		res = Modules::resMan().resolveResHandle( value );
+		if( res != 0x0 && res->getType() == ResourceTypes::Geometry )
+		{
+			_geometryRes = (GeometryResource *)res;
+			updateLocalAABB();
+			markDirty();
+		}
+		else
+		{
+			Modules::setError( "Invalid handle in h3dSetNodeParamI for H3DInstancedMesh::GeoResI" );
+		}
+		return;
+	case InstancedMeshNodeParams::MatResI:
+		res = Modules::resMan().resolveResHandle( value );
+		if( res != 0x0 && res->getType() == ResourceTypes::Material )
+		{
+			_materialRes = (MaterialResource *)res;
+			_sortKey = (float)_materialRes->getHandle();
+		}
+		else
+		{
+			Modules::setError( "Invalid handle in h3dSetNodeParamI for H3DInstancedMesh::MatResI" );
+		}
+		return;
+	case InstancedMeshNodeParams::InstanceCountI:
+		if( value >= 0 )
+			setInstanceCount( (uint32)value );
+		else
+			Modules::setError( "Invalid value in h3dSetNodeParamI for H3DInstancedMesh::InstanceCountI" );
+		return;
+	}
+
+	SceneNode::setParamI( param, value );
+}
+
+
+void InstancedMeshNode::setInstanceCount( uint32 count )
+{
+	// New instances are collapsed to a point and not drawn until they get a transformation
+	_instMatRows.resize( count * 3, Vec4f( 0, 0, 0, 0 ) );
+	markDirty();
+}
+
+
+bool InstancedMeshNode::setInstanceTransMats( const int *instances, const float *mats4x4, int count )
+{
+	bool result = true;
+	
+	for( int i = 0; i < count; ++i )
+	{
+		if( (unsigned)instances[i] >= getInstanceCount() )
+		{
+			result = false;
+			continue;
+		}
+
+		// Matrices come in column major order, the shaders get the first three rows
+		const float *mat = mats4x4 + i * 16;
+		Vec4f *rows = &_instMatRows[instances[i] * 3];
+		for( uint32 j = 0; j < 3; ++j )
+			rows[j] = Vec4f( mat[j], mat[j + 4], mat[j + 8], mat[j + 12] );
+	}
+
+	markDirty();
+	return result;
+}
+
+
+bool InstancedMeshNode::isInstanceCollapsed( uint32 instance )
+{
+	const Vec4f *rows = &_instMatRows[instance * 3];
+	
+	return rows[0].x == 0 && rows[0].y == 0 && rows[0].z == 0 &&
+	       rows[1].x == 0 && rows[1].y == 0 && rows[1].z == 0 &&
+	       rows[2].x == 0 && rows[2].y == 0 && rows[2].z == 0;
+}
+
+
+Matrix4f InstancedMeshNode::getInstanceTransMat( uint32 instance )
+{
+	const Vec4f *rows = &_instMatRows[instance * 3];
+	Matrix4f mat;
+	
+	for( uint32 j = 0; j < 3; ++j )
+	{
+		mat.x[j] = rows[j].x;
+		mat.x[j + 4] = rows[j].y;
+		mat.x[j + 8] = rows[j].z;
+		mat.x[j + 12] = rows[j].w;
+	}
+
+	return mat;
+}
+
+
+void InstancedMeshNode::updateLocalAABB()
+{
+	Vec3f &bBMin = _localBBox.min;
+	Vec3f &bBMax = _localBBox.max;
+	
+	if( _geometryRes != 0x0 && _vertRStart < _geometryRes->getVertCount() &&
+	    _vertREnd < _geometryRes->getVertCount() )
+	{
+		bBMin = Vec3f( Math::MaxFloat, Math::MaxFloat, Math::MaxFloat );
+		bBMax = Vec3f( -Math::MaxFloat, -Math::MaxFloat, -Math::MaxFloat );
+		for( uint32 j = _vertRStart; j <= _vertREnd; ++j )
+		{
+			Vec3f &vertPos = _geometryRes->getVertPosData()[j];
+
+			if( vertPos.x < bBMin.x ) bBMin.x = vertPos.x;
+			if( vertPos.y < bBMin.y ) bBMin.y = vertPos.y;
+			if( vertPos.z < bBMin.z ) bBMin.z = vertPos.z;
+			if( vertPos.x > bBMax.x ) bBMax.x = vertPos.x;
+			if( vertPos.y > bBMax.y ) bBMax.y = vertPos.y;
+			if( vertPos.z > bBMax.z ) bBMax.z = vertPos.z;
+		}
+
+		// Avoid zero box dimensions for planes
+		if( bBMax.x - bBMin.x == 0 ) bBMax.x += Math::Epsilon;
+		if( bBMax.y - bBMin.y == 0 ) bBMax.y += Math::Epsilon;
+		if( bBMax.z - bBMin.z == 0 ) bBMax.z += Math::Epsilon;
+	}
+	else
+	{
+		bBMin = Vec3f( 0, 0, 0 );
+		bBMax = Vec3f( 0, 0, 0 );
+	}
+}
+
+
+void InstancedMeshNode::onPostUpdate()
+{
+	// The node is culled as a whole, its AABB is the union of the instance AABBs
+	BoundingBox bBox;
+	bBox.clear();
+	
+	for( uint32 i = 0, s = getInstanceCount(); i < s; ++i )
+	{
+		if( isInstanceCollapsed( i ) ) continue;
+
+		BoundingBox instBBox = _localBBox;
+		instBBox.transform( getInstanceTransMat( i ) );
+		bBox.makeUnion( instBBox );
+	}
+
+	// Transforming the node space box keeps it conservative
+	bBox.transform( _absTrans );
+	_bBox = bBox;
+}
+
 }  // namespace
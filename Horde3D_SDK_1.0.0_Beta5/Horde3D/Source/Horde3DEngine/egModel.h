@@ -129,5 +129,90 @@ protected:
 	friend class Renderer;
 };
 
+
+// =================================================================================================
+// Instanced Mesh Node
+// =================================================================================================
+
+struct InstancedMeshNodeParams
+{
+	enum List
+	{
+		GeoResI = 800,
+		MatResI,
+		BatchStartI,
+		BatchCountI,
+		VertRStartI,
+		VertREndI,
+		InstanceCountI
+	};
+};
+
+// =================================================================================================
+
+struct InstancedMeshNodeTpl : public SceneNodeTpl
+{
+	PGeometryResource  geoRes;
+	PMaterialResource  matRes;
+	uint32             batchStart, batchCount;
+	uint32             vertRStart, vertREnd;
+	uint32             instanceCount;
+
+	InstancedMeshNodeTpl( const std::string &name, GeometryResource *geoRes, MaterialResource *materialRes,
+	                      uint32 batchStart, uint32 batchCount, uint32 vertRStart, uint32 vertREnd ) :
+		SceneNodeTpl( SceneNodeTypes::InstancedMesh, name ), geoRes( geoRes ), matRes( materialRes ),
+		batchStart( batchStart ), batchCount( batchCount ), vertRStart( vertRStart ), vertREnd( vertREnd ),
+		instanceCount( 0 )
+	{
+	}
+};
+
+// =================================================================================================
+
+class InstancedMeshNode : public SceneNode
+{
+public:
+	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
+
+	~InstancedMeshNode();
+
+	int getParamI( int param );
+	void setParamI( int param, int value );
+
+	void setInstanceCount( uint32 count );
+	bool setInstanceTransMats( const int *instances, const float *mats4x4, int count );
+	bool isInstanceCollapsed( uint32 instance );
+	Matrix4f getInstanceTransMat( uint32 instance );
+
+	GeometryResource *getGeometryResource() { return _geometryRes; }
+	MaterialResource *getMaterialRes() { return _materialRes; }
+	uint32 getBatchStart() { return _batchStart; }
+	uint32 getBatchCount() { return _batchCount; }
+	uint32 getVertRStart() { return _vertRStart; }
+	uint32 getVertREnd() { return _vertREnd; }
+	uint32 getInstanceCount() { return (uint32)_instMatRows.size() / 3; }
+	Vec4f *getInstanceMatRows() { return &_instMatRows[0]; }
+
+protected:
+	InstancedMeshNode( const InstancedMeshNodeTpl &instMeshTpl );
+
+	void updateLocalAABB();
+
+	void onPostUpdate();
+
+protected:
+	PGeometryResource    _geometryRes;
+	PMaterialResource    _materialRes;
+	uint32               _batchStart, _batchCount;
+	uint32               _vertRStart, _vertREnd;
+
+	BoundingBox          _localBBox;  // AABB of one instance in its own space
+	std::vector< Vec4f > _instMatRows;  // First three rows of the transformation of every instance
+
+	friend class SceneManager;
+	friend class Renderer;
+};
+
 }
 #endif // _egModel_H_
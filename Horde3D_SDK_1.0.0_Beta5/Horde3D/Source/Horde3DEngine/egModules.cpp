@@ -116,6 +116,8 @@ bool Modules::init()
 		CameraNode::parsingFunc, CameraNode::factoryFunc, 0x0 );
 	sceneMan().registerType( SceneNodeTypes::Emitter, "Emitter",
 		EmitterNode::parsingFunc, EmitterNode::factoryFunc, Renderer::drawParticles );
+	sceneMan().registerType( SceneNodeTypes::InstancedMesh, "InstancedMesh",
+		InstancedMeshNode::parsingFunc, InstancedMeshNode::factoryFunc, Renderer::drawInstancedMeshes );
 	
 	// Install extensions
 	installExtensions();
@@ -383,6 +383,7 @@ bool Renderer::createShaderComb( const char *vertexShader, const char *fragmentS
 	sc.uni_worldNormalMat = gRDI->getShaderConstLoc( shdObj, "worldNormalMat" );
 	sc.uni_nodeId = gRDI->getShaderConstLoc( shdObj, "nodeId" );
 	sc.uni_skinMatRows = gRDI->getShaderConstLoc( shdObj, "skinMatRows[0]" );
+	sc.uni_instMatRows = gRDI->getShaderConstLoc( shdObj, "instMatRows[0]" );
 	
 	// Lighting uniforms
 	sc.uni_lightPos = gRDI->getShaderConstLoc( shdObj, "lightPos" );
@@ -1731,6 +1732,157 @@ void Renderer::drawMeshes( const string &shaderContext, const string &theClass,
 }
 
 
+void Renderer::drawInstancedMeshes( const string &shaderContext, const string &theClass, bool debugView,
+                                    const Frustum *frust1, const Frustum * /*frust2*/, RenderingOrder::List /*order*/,
+                                    int /*occSet*/ )
+{
+	if( frust1 == 0x0 ) return;
+	
+	GeometryResource *curGeoRes = 0x0;
+	MaterialResource *curMatRes = 0x0;
+
+	// Loop over instanced mesh queue
+	// Note: Occlusion culling is not done for instanced meshes since their boxes are usually large
+	for( size_t i = 0, si = Modules::sceneMan().getRenderableQueue().size(); i < si; ++i )
+	{
+		if( Modules::sceneMan().getRenderableQueue()[i].type != SceneNodeTypes::InstancedMesh ) continue;
+		
+		InstancedMeshNode *instMesh = (InstancedMeshNode *)Modules::sceneMan().getRenderableQueue()[i].node;
+		GeometryResource *geoRes = instMesh->getGeometryResource();
+		uint32 instCount = instMesh->getInstanceCount();
+		
+		// Check that mesh is valid
+		if( geoRes == 0x0 || instMesh->getMaterialRes() == 0x0 || instCount == 0 )
+			continue;
+		if( instMesh->getBatchStart() + instMesh->getBatchCount() > geoRes->_indexCount )
+			continue;
+		
+		// Bind geometry
+		if( curGeoRes != geoRes )
+		{
+			curGeoRes = geoRes;
+		
+			// Indices
+			gRDI->setIndexBuffer( curGeoRes->getIndexBuf(),
+			                      curGeoRes->_16BitIndices ? IDXFMT_16 : IDXFMT_32 );
+
+			// Vertices
+			uint32 posVBuf = curGeoRes->getPosVBuf();
+			uint32 tanVBuf = curGeoRes->getTanVBuf();
+			uint32 staticVBuf = curGeoRes->getStaticVBuf();
+			
+			gRDI->setVertexBuffer( 0, posVBuf, 0, sizeof( Vec3f ) );
+			gRDI->setVertexBuffer( 1, tanVBuf, 0, sizeof( VertexDataTan ) );
+			gRDI->setVertexBuffer( 2, tanVBuf, sizeof( Vec3f ), sizeof( VertexDataTan ) );
+			gRDI->setVertexBuffer( 3, staticVBuf, 0, sizeof( VertexDataStatic ) );
+		}
+
+		gRDI->setVertexLayout( Modules::renderer()._vlModel );
+		
+		if( !debugView )
+		{
+			if( !instMesh->getMaterialRes()->isOfClass( theClass ) ) continue;
+			
+			// Set material
+			if( curMatRes != instMesh->getMaterialRes() )
+			{
+				if( !Modules::renderer().setMaterial( instMesh->getMaterialRes(), shaderContext ) )
+				{	
+					curMatRes = 0x0;
+					continue;
+				}
+				curMatRes = instMesh->getMaterialRes();
+			}
+		}
+		else
+		{
+			Modules::renderer().setShaderComb( &Modules::renderer()._defColorShader );
+			Modules::renderer().commitGeneralUniforms();
+			
+			Vec4f color( 0.5f, 0.75f, 1, 1 );
+			gRDI->setShaderConst( Modules::renderer()._defColShader_color, CONST_FLOAT4, &color.x );
+		}
+
+		ShaderCombination *curShader = Modules::renderer().getCurShader();
+		
+		// Node transformation, instances are placed relative to it
+		if( curShader->uni_nodeId >= 0 )
+		{
+			float id = (float)instMesh->getHandle();
+			gRDI->setShaderConst( curShader->uni_nodeId, CONST_FLOAT, &id );
+		}
+		if( curShader->uni_instMatRows >= 0 )
+		{
+			if( curShader->uni_worldMat >= 0 )
+			{
+				gRDI->setShaderConst( curShader->uni_worldMat, CONST_FLOAT44, &instMesh->_absTrans.x[0] );
+			}
+			if( curShader->uni_worldNormalMat >= 0 )
+			{
+				Matrix4f normalMat4 = instMesh->_absTrans.inverted().transposed();
+				float normalMat[9] = { normalMat4.x[0], normalMat4.x[1], normalMat4.x[2],
+				                       normalMat4.x[4], normalMat4.x[5], normalMat4.x[6],
+				                       normalMat4.x[8], normalMat4.x[9], normalMat4.x[10] };
+				gRDI->setShaderConst( curShader->uni_worldNormalMat, CONST_FLOAT33, normalMat );
+			}
+		}
+
+		Vec4f *instMatRows = instMesh->getInstanceMatRows();
+		uint32 batchStart = instMesh->getBatchStart(), batchCount = instMesh->getBatchCount();
+		
+		if( curShader->uni_instMatRows >= 0 && gRDI->getCaps().instancing )
+		{
+			// Draw the instances in batches as large as the row array of the shader
+			for( uint32 j = 0; j < instCount; j += InstancesPerBatch )
+			{
+				uint32 count = std::min( instCount - j, InstancesPerBatch );
+				
+				gRDI->setShaderConst( curShader->uni_instMatRows, CONST_FLOAT4, &instMatRows[j * 3], count * 3 );
+				gRDI->drawIndexedInstanced( PRIM_TRILIST, batchStart, batchCount, count );
+				Modules::stats().incStat( EngineStats::BatchCount, 1 );
+				Modules::stats().incStat( EngineStats::TriCount, batchCount / 3.0f * count );
+			}
+		}
+		else
+		{
+			// Without instancing support or an instancing shader every instance is a draw call
+			for( uint32 j = 0; j < instCount; ++j )
+			{
+				if( instMesh->isInstanceCollapsed( j ) ) continue;
+				
+				if( curShader->uni_instMatRows >= 0 )
+				{
+					gRDI->setShaderConst( curShader->uni_instMatRows, CONST_FLOAT4, &instMatRows[j * 3], 3 );
+				}
+				else
+				{
+					Matrix4f worldMat = instMesh->_absTrans * instMesh->getInstanceTransMat( j );
+					if( curShader->uni_worldMat >= 0 )
+					{
+						gRDI->setShaderConst( curShader->uni_worldMat, CONST_FLOAT44, &worldMat.x[0] );
+					}
+					if( curShader->uni_worldNormalMat >= 0 )
+					{
+						Matrix4f normalMat4 = worldMat.inverted().transposed();
+						float normalMat[9] = { normalMat4.x[0], normalMat4.x[1], normalMat4.x[2],
+						                       normalMat4.x[4], normalMat4.x[5], normalMat4.x[6],
+						                       normalMat4.x[8], normalMat4.x[9], normalMat4.x[10] };
+						gRDI->setShaderConst( curShader->uni_worldNormalMat, CONST_FLOAT33, normalMat );
+					}
+				}
+
+				gRDI->drawIndexed( PRIM_TRILIST, batchStart, batchCount,
+				                   instMesh->getVertRStart(), instMesh->getVertREnd() - instMesh->getVertRStart() + 1 );
+				Modules::stats().incStat( EngineStats::BatchCount, 1 );
+				Modules::stats().incStat( EngineStats::TriCount, batchCount / 3.0f );
+			}
+		}
+	}
+
+	gRDI->setVertexLayout( 0 );
+}
+
+
 void Renderer::drawParticles( const string &shaderContext, const string &theClass, bool debugView,
                               const Frustum *frust1, const Frustum * /*frust2*/, RenderingOrder::List /*order*/,
                               int occSet )
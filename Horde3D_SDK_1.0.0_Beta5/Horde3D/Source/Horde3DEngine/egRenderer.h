@@ -30,6 +30,7 @@ struct ShaderContext;
 
 const uint32 MaxNumOverlayVerts = 65536;
 const uint32 ParticlesPerBatch = 64;	// Warning: The GPU must have enough registers
+const uint32 InstancesPerBatch = 64;	// Ditto
 const uint32 QuadIndexBufCount = MaxNumOverlayVerts * 6;
 
 extern const char *vsDefColor;
@@ -138,6 +139,8 @@ public:
 		const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 	static void drawParticles( const std::string &shaderContext, const std::string &theClass, bool debugView,
 		const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
+	static void drawInstancedMeshes( const std::string &shaderContext, const std::string &theClass, bool debugView,
+		const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 
 	void render( CameraNode *camNode );
 	void finalizeFrame();
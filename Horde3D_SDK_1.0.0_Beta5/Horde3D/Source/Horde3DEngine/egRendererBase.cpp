@@ -211,6 +211,7 @@ bool RenderDevice::init()
 	_caps.texFloat = glExt::ARB_texture_float ? 1 : 0;
 	_caps.texNPOT = glExt::ARB_texture_non_power_of_two ? 1 : 0;
 	_caps.rtMultisampling = glExt::EXT_framebuffer_multisample ? 1 : 0;
+	_caps.instancing = glExt::ARB_draw_instanced ? 1 : 0;
 
 	// Find supported depth format (some old ATI cards only support 16 bit depth for FBOs)
 	_depthFormat = GL_DEPTH_COMPONENT24;
@@ -1370,4 +1371,21 @@ void RenderDevice::drawIndexed( RDIPrimType primType, uint32 firstIndex, uint32
 	CHECK_GL_ERROR
 }
 
+
+void RenderDevice::drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+                                         uint32 numInstances )
+{
+	ASSERT( _caps.instancing );
+	
+	if( commitStates() )
+	{
+		firstIndex *= (_indexFormat == IDXFMT_16) ? sizeof( short ) : sizeof( int );
+		
+		glDrawElementsInstancedARB( (uint32)primType, numIndices, _indexFormat,
+		                            (char *)0 + firstIndex, numInstances );
+	}
+
+	CHECK_GL_ERROR
+}
+
 }  // namespace
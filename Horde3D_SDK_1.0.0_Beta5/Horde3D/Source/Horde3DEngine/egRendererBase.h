@@ -107,6 +107,7 @@ struct DeviceCaps
 	bool  texFloat;
 	bool  texNPOT;
 	bool  rtMultisampling;
+	bool  instancing;
 };
 
 
@@ -409,6 +410,8 @@ public:
 	void draw( RDIPrimType primType, uint32 firstVert, uint32 numVerts );
 	void drawIndexed( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
 	                  uint32 firstVert, uint32 numVerts );
+	void drawIndexedInstanced( RDIPrimType primType, uint32 firstIndex, uint32 numIndices,
+	                           uint32 numInstances );
 
 // -----------------------------------------------------------------------------
 // Getters
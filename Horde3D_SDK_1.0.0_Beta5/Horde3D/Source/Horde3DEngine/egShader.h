@@ -131,6 +131,7 @@ struct ShaderCombination
 	int                 uni_viewMat, uni_viewMatInv, uni_projMat, uni_viewProjMat, uni_viewProjMatInv, uni_viewerPos;
 	int                 uni_worldMat, uni_worldNormalMat, uni_nodeId;
 	int                 uni_skinMatRows;
+	int                 uni_instMatRows;
 	int                 uni_lightPos, uni_lightDir, uni_lightColor;
 	int                 uni_shadowSplitDists, uni_shadowMats, uni_shadowMapSize, uni_shadowBias;
 	int                 uni_parPosArray, uni_parSizeAndRotArray, uni_parColorArray;
@@ -26,6 +26,7 @@ namespace glExt
 	bool ARB_texture_float = false;
 	bool ARB_texture_non_power_of_two = false;
 	bool ARB_timer_query = false;
+	bool ARB_draw_instanced = false;
 
 	int	majorVersion = 1, minorVersion = 0;
 }
@@ -181,6 +182,9 @@ PFNGLRENDERBUFFERSTORAGEMULTISAMPLEEXTPROC glRenderbufferStorageMultisampleEXT =
 PFNGLQUERYCOUNTERPROC glQueryCounter = 0x0;
 PFNGLGETQUERYOBJECTI64VPROC glGetQueryObjecti64v = 0x0;
 PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v = 0x0;
+
+// GL_ARB_draw_instanced
+PFNGLDRAWELEMENTSINSTANCEDARBPROC glDrawElementsInstancedARB = 0x0;
 }  // namespace h3dGL
 
 
@@ -437,5 +441,11 @@ bool initOpenGLExtensions()
 		r &= (glGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC) platGetProcAddress( "glGetQueryObjectui64v" )) != 0x0;
 	}
 
+	glExt::ARB_draw_instanced = isExtensionSupported( "GL_ARB_draw_instanced" );
+	if( glExt::ARB_draw_instanced )
+	{
+		r &= (glDrawElementsInstancedARB = (PFNGLDRAWELEMENTSINSTANCEDARBPROC) platGetProcAddress( "glDrawElementsInstancedARB" )) != 0x0;
+	}
+
 	return r;
 }
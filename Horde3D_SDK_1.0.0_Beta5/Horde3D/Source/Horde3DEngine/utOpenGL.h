@@ -55,6 +55,7 @@ namespace glExt
 	extern bool ARB_texture_float;
 	extern bool ARB_texture_non_power_of_two;
 	extern bool ARB_timer_query;
+	extern bool ARB_draw_instanced;
 
 	extern int  majorVersion, minorVersion;
 }
@@ -1137,6 +1138,16 @@ extern PFNGLQUERYCOUNTERPROC glQueryCounter;
 extern PFNGLGETQUERYOBJECTI64VPROC glGetQueryObjecti64v;
 extern PFNGLGETQUERYOBJECTUI64VPROC glGetQueryObjectui64v;
 
+#endif
+
+
+// ARB_draw_instanced
+#ifndef GL_ARB_draw_instanced
+#define GL_ARB_draw_instanced 1
+
+typedef void (GLAPIENTRYP PFNGLDRAWELEMENTSINSTANCEDARBPROC) (GLenum mode, GLsizei count, GLenum type, const GLvoid *indices, GLsizei primcount);
+extern PFNGLDRAWELEMENTSINSTANCEDARBPROC glDrawElementsInstancedARB;
+
 #endif
 }  // namespace h3dGL
 
@@ -0,0 +1,48 @@
+
+#include <horde3d.h>
+
+#include "../src/resources.h"
+
+/**
+    No-op stand-ins for the few Horde3D and resource calls world_geo.cpp
+    links against, so pathfinding benchmarks can run without a window or
+    GL context.
+*/
+
+H3DRes h3dFindResource(int type, const char* name)
+{
+  return 0;
+}
+
+void h3dUnloadResource(H3DRes res)
+{
+}
+
+H3DNode h3dAddModelNode(H3DNode parent, const char* name, H3DRes geo)
+{
+  return 0;
+}
+
+H3DNode h3dAddMeshNode(H3DNode parent, const char* name, H3DRes mat,
+                      int batch_start, int batch_count,
+                      int vert_r_start, int vert_r_end)
+{
+  return 0;
+}
+
+void h3dRemoveNode(H3DNode node)
+{
+}
+
+void h3dSetNodeTransform(H3DNode node, float tx, float ty, float tz,
+                        float rx, float ry, float rz,
+                        float sx, float sy, float sz)
+{
+}
+
+void Resources::create2DMesh(H3DRes res,
+                            std::vector<std::pair<float, float>>& verts,
+                            std::vector<int>& indices, int& vert_n, int& idx_n)
+{
+  vert_n = idx_n = 0;
+}
@@ -0,0 +1,1155 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../src/world_geo.h"
+#include "../src/utils.h"
+
+/**
+    Pathfinding micro-benchmarks.
+    Builds procedural blocked maps of increasing size and measures the
+    latency of short findPath queries, which should not depend on the
+    total number of navmesh triangles. queries spread over the whole map
+    still slow down on larger maps, as the triangles they touch fall out of
+    the caches, so the same queries are also timed in one corner.
+*/
+
+namespace
+{
+  using BlockedMapT = WorldGeo::BlockedMapT;
+  using Clock = std::chrono::steady_clock;
+
+  constexpr int __queries = 20000;
+  constexpr float __short_range = 2.;
+  //side of the corner the local short queries start in, in world units
+  constexpr float __local_extent = 30.;
+  //as given to units by entities.cpp
+  constexpr float __unit_radius = .25;
+
+  //blocked map with a solid border and a jittered grid of round obstacles
+  void _generateMap(BlockedMapT& map, int w, int h, unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> jitter(-8, 8);
+    std::uniform_int_distribution<int> radius(6, 14);
+
+    map.reset();
+    for(int x = 0; x < w; ++x)
+    {
+      map.set(x);
+      map.set(x + (h - 1) * w);
+    }
+    for(int y = 0; y < h; ++y)
+    {
+      map.set(y * w);
+      map.set(w - 1 + y * w);
+    }
+
+    for(int cy = 32; cy < h - 32; cy += 48)
+    for(int cx = 32; cx < w - 32; cx += 48)
+    {
+      int ox = cx + jitter(rng);
+      int oy = cy + jitter(rng);
+      int rx = radius(rng);
+      int ry = radius(rng);
+      for(int y = oy - ry; y <= oy + ry; ++y)
+      for(int x = ox - rx; x <= ox + rx; ++x)
+        map.set(x + y * w);
+    }
+  }
+
+  //picks a random unblocked point, in world units
+  void _freePoint(const BlockedMapT& map, int w, int h,
+                  std::mt19937& rng, float* x, float* y)
+  {
+    std::uniform_real_distribution<float> dx(1., w / 8 - 1);
+    std::uniform_real_distribution<float> dy(1., h / 8 - 1);
+    do
+    {
+      *x = dx(rng);
+      *y = dy(rng);
+    }while(map[(int)(*x * 8) + (int)(*y * 8) * w]
+          || WorldGeo::isBlocked(*x, *y));
+  }
+
+  //waypoint count of a path, which is freed
+  int _consumePath(WorldGeo::PathHandle path)
+  {
+    if(path == 0)
+      return 0;
+    unsigned length;
+    WorldGeo::getPath(path, &length);
+    WorldGeo::freePath(path);
+    return length;
+  }
+
+  int _async_waypoints;
+
+  void _receivePath(void*, WorldGeo::PathHandle path)
+  {
+    _async_waypoints += _consumePath(path);
+  }
+
+  //a move order waiting for its path
+  struct __Order
+  {
+    float x, y;
+    bool arrived;
+    WorldGeo::PathHandle path;
+  };
+
+  void _receiveOrder(void* owner, WorldGeo::PathHandle path)
+  {
+    __Order* order = (__Order*)owner;
+    order->arrived = true;
+    order->path = path;
+  }
+
+  //local queries start in the same corner on every map, so the memory they
+  //touch does not grow with it
+  void _benchShortPaths(int size, bool local)
+  {
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> offset(-__short_range, __short_range);
+    std::vector<float> points;
+    points.reserve(__queries * 4);
+    for(int n = 0; n < __queries; ++n)
+    {
+      float x, y, tx, ty;
+      do
+      {
+        _freePoint(*map, w, h, rng, &x, &y);
+      }while(local && (x > __local_extent || y > __local_extent));
+      do
+      {
+        tx = x + offset(rng);
+        ty = y + offset(rng);
+      }while(tx < 1. || ty < 1. || tx > size - 1 || ty > size - 1
+            || WorldGeo::isBlocked(tx, ty));
+      points.push_back(x);
+      points.push_back(y);
+      points.push_back(tx);
+      points.push_back(ty);
+    }
+
+    int waypoints = 0;
+    auto start = Clock::now();
+    for(int n = 0; n < __queries; ++n)
+    {
+      waypoints += _consumePath(
+        WorldGeo::findPath(points[n * 4], points[n * 4 + 1],
+                           points[n * 4 + 2], points[n * 4 + 3]));
+    }
+    auto end = Clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("short %s  map %3ix%-3i  %8.0f ns/query  (%i waypoints)\n",
+                local? "local   " : "findPath", size, size, ns / __queries,
+                waypoints);
+    std::fflush(stdout);
+    if(local)
+    {
+      WorldGeo::deleteNavMesh();
+      return;
+    }
+
+    //the same queries through the request service
+    _async_waypoints = 0;
+    start = Clock::now();
+    for(int n = 0; n < __queries; ++n)
+      WorldGeo::requestPath(points[n * 4], points[n * 4 + 1],
+                            points[n * 4 + 2], points[n * 4 + 3], nullptr);
+    WorldGeo::deliverPaths(0, _receivePath);
+    WorldGeo::deliverPaths(__queries, _receivePath);
+    end = Clock::now();
+
+    ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("short requests  map %3ix%-3i  %8.0f ns/query  (%i waypoints)%s\n",
+                size, size, ns / __queries, _async_waypoints,
+                _async_waypoints == waypoints? "" : "  MISMATCH");
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //waypoints of a fixed set of paths, to compare navmeshes
+  std::vector<float> _pathSignature(const BlockedMapT& map, int w, int h)
+  {
+    std::mt19937 rng(9);
+    std::vector<float> signature;
+    for(int n = 0; n < 200; ++n)
+    {
+      float x, y, tx, ty;
+      _freePoint(map, w, h, rng, &x, &y);
+      _freePoint(map, w, h, rng, &tx, &ty);
+      WorldGeo::PathHandle path = WorldGeo::findPath(x, y, tx, ty);
+      unsigned length = 0;
+      const PathPoint* points = path? WorldGeo::getPath(path, &length)
+                                    : nullptr;
+      for(unsigned m = 0; m < length; ++m)
+      {
+        signature.push_back(points[m].x);
+        signature.push_back(points[m].y);
+      }
+      signature.push_back(-1.);
+      WorldGeo::freePath(path);
+    }
+    return signature;
+  }
+
+  //building the navmesh against loading it from a cache file
+  void _benchNavMeshCache(int size)
+  {
+    const char* path = "bench_navmesh.cache";
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    auto start = Clock::now();
+    WorldGeo::setupNavMesh(w, h, map.get());
+    auto end = Clock::now();
+    double build_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+    std::vector<float> built = _pathSignature(*map, w, h);
+
+    start = Clock::now();
+    bool saved = WorldGeo::saveNavMesh(path);
+    end = Clock::now();
+    double save_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+    WorldGeo::deleteNavMesh();
+    WorldGeo::invalidateNavMesh();
+
+    start = Clock::now();
+    bool loaded = WorldGeo::loadNavMesh(path, w, h, map.get());
+    end = Clock::now();
+    double load_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+    bool same = loaded && _pathSignature(*map, w, h) == built;
+    WorldGeo::deleteNavMesh();
+
+    //an edited map must not use the file
+    map->flip(w * h / 2 + w / 2);
+    bool rejected = !WorldGeo::loadNavMesh(path, w, h, map.get());
+    std::remove(path);
+
+    std::printf("navmesh cache   map %3ix%-3i  build %8.2f ms  save %6.2f ms  "
+                "load %6.2f ms%s\n", size, size, build_ms, save_ms, load_ms,
+                saved && same && rejected? "" : "  MISMATCH");
+    std::fflush(stdout);
+  }
+
+  //point location as done by isBlocked and pushIn for every entity
+  void _benchLocate(int size)
+  {
+    constexpr int queries = 1000000;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> coord(0., size);
+    std::vector<float> points(queries * 2);
+    for(auto& p: points)
+      p = coord(rng);
+
+    int blocked = 0;
+    auto start = Clock::now();
+    for(int n = 0; n < queries; ++n)
+      blocked += WorldGeo::isBlocked(points[n * 2], points[n * 2 + 1]);
+    auto end = Clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("isBlocked       map %3ix%-3i  %8.1f ns/query  (%i blocked)\n",
+                size, size, ns / queries, blocked);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //units stepping 0.05 per tick like Entity::finalize, located from
+  //scratch and from a per unit triangle hint
+  void _benchMovingUnits(int size)
+  {
+    constexpr int units = 1000;
+    constexpr int ticks = 500;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> angle(0., 6.2831853);
+    std::vector<float> pos(units * 2), dir(units * 2);
+    for(int n = 0; n < units; ++n)
+    {
+      _freePoint(*map, w, h, rng, &pos[n * 2], &pos[n * 2 + 1]);
+      float a = angle(rng);
+      dir[n * 2] = std::cos(a) / 20;
+      dir[n * 2 + 1] = std::sin(a) / 20;
+    }
+
+    //the same walk twice, units turn back when blocked
+    auto run = [&](bool hinted, int* blocked)->double
+    {
+      std::vector<float> p(pos), d(dir);
+      std::vector<int> hints(units, -1);
+      *blocked = 0;
+      auto start = Clock::now();
+      for(int t = 0; t < ticks; ++t)
+      for(int n = 0; n < units; ++n)
+      {
+        float x = p[n * 2] + d[n * 2];
+        float y = p[n * 2 + 1] + d[n * 2 + 1];
+        bool b = hinted? WorldGeo::isBlocked(x, y, hints[n])
+                       : WorldGeo::isBlocked(x, y);
+        if(b)
+        {
+          ++*blocked;
+          d[n * 2] = -d[n * 2];
+          d[n * 2 + 1] = -d[n * 2 + 1];
+        }
+        else
+        {
+          p[n * 2] = x;
+          p[n * 2 + 1] = y;
+        }
+      }
+      auto end = Clock::now();
+      return std::chrono::duration<double, std::nano>(end - start).count()
+        / (units * ticks);
+    };
+
+    int plain_blocked, hinted_blocked;
+    double plain_ns = run(false, &plain_blocked);
+    double hinted_ns = run(true, &hinted_blocked);
+
+    std::printf("moving units    map %3ix%-3i  grid %6.1f ns  hint %6.1f ns"
+                "  (%i blocked)%s\n", size, size, plain_ns, hinted_ns,
+                plain_blocked,
+                plain_blocked == hinted_blocked? "" : "  MISMATCH");
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //full navmesh build against rebuilding after small obstacle edits
+  void _benchNavMeshBuild(int size)
+  {
+    constexpr int edits = 20;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+
+    WorldGeo::invalidateNavMesh();
+    auto start = Clock::now();
+    WorldGeo::setupNavMesh(w, h, map.get());
+    auto end = Clock::now();
+    double full_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+
+    //place building sized blocks on free ground and remove them again
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> pos(16, w - 32);
+    double edit_ms = 0.;
+    for(int n = 0; n < edits; ++n)
+    {
+      int x0, y0;
+      bool free;
+      do
+      {
+        x0 = pos(rng);
+        y0 = pos(rng);
+        free = true;
+        for(int y = y0 - 2; y < y0 + 18 && free; ++y)
+        for(int x = x0 - 2; x < x0 + 18 && free; ++x)
+          free = !(*map)[x + y * w];
+      }while(!free);
+
+      for(int set = 1; set >= 0; --set)
+      {
+        for(int y = y0; y < y0 + 16; ++y)
+        for(int x = x0; x < x0 + 16; ++x)
+          map->set(x + y * w, set);
+        WorldGeo::invalidateNavMesh(x0, y0, x0 + 16, y0 + 16);
+
+        start = Clock::now();
+        WorldGeo::updateNavMesh();
+        end = Clock::now();
+        edit_ms +=
+          std::chrono::duration<double, std::milli>(end - start).count();
+      }
+    }
+
+    std::printf("navmesh build   map %3ix%-3i  full %8.2f ms  edit %8.2f ms\n",
+                size, size, full_ms, edit_ms / (edits * 2));
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  /*
+    building footprints placed on free ground as dynamic obstacles, against
+    the same edits through the blocked map and updateNavMesh. paths are
+    then checked against the footprints, and the navmesh after removing
+    every obstacle against the one before.
+  */
+  void _benchObstacles(int size)
+  {
+    constexpr int obstacles = 20;
+    constexpr int queries = 500;
+    constexpr float side = 2.;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+    WorldGeo::NavMeshStats before;
+    WorldGeo::getNavMeshStats(&before);
+
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> pos(2., size - 2. - side);
+    std::vector<PathPoint> corners;
+    for(int n = 0; n < obstacles; ++n)
+    {
+      float x, y;
+      bool free;
+      do
+      {
+        x = pos(rng);
+        y = pos(rng);
+        free = true;
+        for(int cy = (int)(y * 8) - 4;
+            cy < (int)((y + side) * 8) + 4 && free; ++cy)
+        for(int cx = (int)(x * 8) - 4; cx < (int)((x + side) * 8) + 4 && free;
+            ++cx)
+          free = !(*map)[cx + cy * w];
+      }while(!free);
+      corners.push_back({x, y});
+    }
+
+    std::vector<WorldGeo::ObstacleId> ids;
+    auto start = Clock::now();
+    for(auto& corner: corners)
+    {
+      PathPoint footprint[4] = {{corner.x, corner.y},
+        {corner.x + side, corner.y}, {corner.x + side, corner.y + side},
+        {corner.x, corner.y + side}};
+      ids.push_back(WorldGeo::addObstacle(footprint, 4));
+    }
+    auto end = Clock::now();
+    double add_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    //path samples inside a footprint, shrunk by a cell for the outlines
+    int blocked_centers = 0;
+    for(auto& corner: corners)
+      blocked_centers += WorldGeo::isBlocked(corner.x + side / 2,
+                                             corner.y + side / 2);
+    int crossing_paths = 0;
+    int found = 0;
+    for(int n = 0; n < queries; ++n)
+    {
+      float x, y, tx, ty;
+      do _freePoint(*map, w, h, rng, &x, &y);
+      while(WorldGeo::isBlocked(x, y));
+      do _freePoint(*map, w, h, rng, &tx, &ty);
+      while(WorldGeo::isBlocked(tx, ty));
+      WorldGeo::PathHandle path = WorldGeo::findPath(x, y, tx, ty);
+      if(path == 0)
+        continue;
+      ++found;
+      unsigned length;
+      const PathPoint* points = WorldGeo::getPath(path, &length);
+      bool crosses = false;
+      float last_x = x, last_y = y;
+      for(unsigned m = 0; m < length && !crosses; ++m)
+      {
+        float dx = points[m].x - last_x;
+        float dy = points[m].y - last_y;
+        int steps = std::sqrt(dx * dx + dy * dy) * 20 + 1;
+        for(int k = 0; k <= steps && !crosses; ++k)
+        {
+          float px = last_x + dx * k / steps;
+          float py = last_y + dy * k / steps;
+          for(auto& corner: corners)
+          {
+            if(px > corner.x + .125f && px < corner.x + side - .125f
+              && py > corner.y + .125f && py < corner.y + side - .125f)
+              crosses = true;
+          }
+        }
+        last_x = points[m].x;
+        last_y = points[m].y;
+      }
+      crossing_paths += crosses;
+      WorldGeo::freePath(path);
+    }
+
+    start = Clock::now();
+    for(auto id: ids)
+      WorldGeo::removeObstacle(id);
+    end = Clock::now();
+    double remove_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    WorldGeo::NavMeshStats after;
+    WorldGeo::getNavMeshStats(&after);
+    //spliced triangles are searched without the cluster graph, so compare
+    //the mesh itself rather than the paths over it
+    bool same = after.triangles == before.triangles
+      && after.plates == before.plates
+      && after.components == before.components;
+
+    //the same footprints through the blocked map
+    double update_us = 0.;
+    for(auto& corner: corners)
+    {
+      int x0 = corner.x * 8, y0 = corner.y * 8;
+      int x1 = (corner.x + side) * 8, y1 = (corner.y + side) * 8;
+      for(int set = 1; set >= 0; --set)
+      {
+        for(int y = y0; y < y1; ++y)
+        for(int x = x0; x < x1; ++x)
+          map->set(x + y * w, set);
+        WorldGeo::invalidateNavMesh(x0, y0, x1, y1);
+        start = Clock::now();
+        WorldGeo::updateNavMesh();
+        end = Clock::now();
+        update_us +=
+          std::chrono::duration<double, std::micro>(end - start).count();
+      }
+    }
+
+    std::printf("obstacles       map %3ix%-3i  carve %7.0f us  remove %7.0f us"
+                "  rebuild %7.0f us  (%i/%i blocked, %i/%i paths cross,"
+                " %s mesh after removal)\n",
+                size, size, add_us / obstacles, remove_us / obstacles,
+                update_us / (obstacles * 2), blocked_centers, obstacles,
+                crossing_paths, found, same? "same" : "different");
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  /*
+    move orders issued just before an obstacle is added still arrive,
+    searched on the carved navmesh. the obstacle is a wall across most of
+    the map between the starts and the destinations.
+  */
+  void _checkPendingOrders(int size)
+  {
+    constexpr int orders = 200;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(9);
+    std::vector<__Order> pending(orders);
+    for(auto& order: pending)
+    {
+      float tx, ty;
+      do _freePoint(*map, w, h, rng, &order.x, &order.y);
+      while(order.y > size / 2 - 2);
+      do _freePoint(*map, w, h, rng, &tx, &ty);
+      while(ty < size / 2 + 3);
+      order.arrived = false;
+      order.path = 0;
+      WorldGeo::requestPath(order.x, order.y, tx, ty, &order);
+    }
+
+    float x0 = 1., x1 = size * .75f;
+    float y0 = size / 2, y1 = size / 2 + 1;
+    PathPoint wall[4] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+    WorldGeo::ObstacleId id = WorldGeo::addObstacle(wall, 4);
+    WorldGeo::deliverPaths(0, _receiveOrder);
+    WorldGeo::deliverPaths(orders, _receiveOrder);
+
+    int arrived = 0;
+    int found = 0;
+    int crossing = 0;
+    for(auto& order: pending)
+    {
+      arrived += order.arrived;
+      if(order.path == 0)
+        continue;
+      ++found;
+      unsigned length;
+      const PathPoint* points = WorldGeo::getPath(order.path, &length);
+      bool crosses = false;
+      float last_x = order.x, last_y = order.y;
+      for(unsigned m = 0; m < length && !crosses; ++m)
+      {
+        float dx = points[m].x - last_x;
+        float dy = points[m].y - last_y;
+        int steps = std::sqrt(dx * dx + dy * dy) * 20 + 1;
+        for(int k = 0; k <= steps && !crosses; ++k)
+        {
+          float px = last_x + dx * k / steps;
+          float py = last_y + dy * k / steps;
+          crosses = px > x0 + .125f && px < x1 - .125f
+                  && py > y0 + .125f && py < y1 - .125f;
+        }
+        last_x = points[m].x;
+        last_y = points[m].y;
+      }
+      crossing += crosses;
+      WorldGeo::freePath(order.path);
+    }
+    WorldGeo::removeObstacle(id);
+
+    std::printf("pending orders  map %3ix%-3i  %i/%i arrived  (%i found, %i"
+                " cross the obstacle)\n", size, size, arrived, orders, found,
+                crossing);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //random start and destination pairs at least half the map apart
+  void _benchLongPaths(int size)
+  {
+    constexpr int queries = 1000;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(4);
+    std::vector<float> points;
+    for(int n = 0; n < queries; ++n)
+    {
+      float x, y, tx, ty;
+      do
+      {
+        _freePoint(*map, w, h, rng, &x, &y);
+        _freePoint(*map, w, h, rng, &tx, &ty);
+      }while((tx - x) * (tx - x) + (ty - y) * (ty - y) < size * size / 4);
+      points.push_back(x);
+      points.push_back(y);
+      points.push_back(tx);
+      points.push_back(ty);
+    }
+
+    int waypoints = 0;
+    auto start = Clock::now();
+    for(int n = 0; n < queries; ++n)
+    {
+      waypoints += _consumePath(
+        WorldGeo::findPath(points[n * 4], points[n * 4 + 1],
+                           points[n * 4 + 2], points[n * 4 + 3]));
+    }
+    auto end = Clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("long findPath   map %3ix%-3i  %8.0f ns/query  (%i waypoints)\n",
+                size, size, ns / queries, waypoints);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //destinations inside obstacles next to the start, as when clicking on a
+  //cliff, so that moving the destination onto the mesh dominates
+  void _benchBlockedDestination(int size)
+  {
+    constexpr int queries = 5000;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> offset(-__short_range * 2,
+                                                 __short_range * 2);
+    std::vector<float> points;
+    for(int n = 0; n < queries; ++n)
+    {
+      float x, y, tx, ty;
+      do
+      {
+        _freePoint(*map, w, h, rng, &x, &y);
+        tx = x + offset(rng);
+        ty = y + offset(rng);
+      }while(tx < 1. || ty < 1. || tx > size - 1 || ty > size - 1
+            || !WorldGeo::isBlocked(tx, ty));
+      points.push_back(x);
+      points.push_back(y);
+      points.push_back(tx);
+      points.push_back(ty);
+    }
+
+    std::vector<WorldGeo::PathHandle> paths(queries);
+    auto start = Clock::now();
+    for(int n = 0; n < queries; ++n)
+      paths[n] = WorldGeo::findPath(points[n * 4], points[n * 4 + 1],
+                                    points[n * 4 + 2], points[n * 4 + 3]);
+    auto end = Clock::now();
+
+    //how far the path ends from the requested destination
+    double moved = 0.;
+    int found = 0;
+    for(int n = 0; n < queries; ++n)
+    {
+      unsigned length;
+      const PathPoint* path = WorldGeo::getPath(paths[n], &length);
+      if(path == nullptr || length == 0)
+        continue;
+      ++found;
+      moved += std::sqrt((path[length - 1].x - points[n * 4 + 2])
+                          * (path[length - 1].x - points[n * 4 + 2])
+                        + (path[length - 1].y - points[n * 4 + 3])
+                          * (path[length - 1].y - points[n * 4 + 3]));
+      WorldGeo::freePath(paths[n]);
+    }
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    std::printf("blocked dest    map %3ix%-3i  %8.0f ns/query  (%i paths, "
+                "moved %.3f)\n", size, size, ns / queries, found,
+                found? moved / found : 0.);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //share of path samples where a unit of radius would overlap blocked cells
+  double _wallContact(const BlockedMapT& map, int w, int h,
+                      WorldGeo::PathHandle path, float x, float y,
+                      float radius)
+  {
+    unsigned length;
+    const PathPoint* points = WorldGeo::getPath(path, &length);
+    int samples = 0;
+    int contacts = 0;
+    for(unsigned n = 0; n < length; ++n)
+    {
+      float dx = points[n].x - x;
+      float dy = points[n].y - y;
+      int steps = std::max(1, (int)(std::sqrt(dx * dx + dy * dy) * 16));
+      for(int k = 0; k < steps; ++k)
+      {
+        float px = x + dx * k / steps;
+        float py = y + dy * k / steps;
+        bool contact = false;
+        for(int cy = (int)((py - radius) * 8); cy <= (int)((py + radius) * 8)
+            && !contact; ++cy)
+        for(int cx = (int)((px - radius) * 8); cx <= (int)((px + radius) * 8)
+            && !contact; ++cx)
+        {
+          if(cx < 0 || cy < 0 || cx >= w || cy >= h || !map[cx + cy * w])
+            continue;
+          //distance from the point to the cell
+          float nx = std::min(std::max(px, cx / 8.f), (cx + 1) / 8.f) - px;
+          float ny = std::min(std::max(py, cy / 8.f), (cy + 1) / 8.f) - py;
+          contact = nx * nx + ny * ny < radius * radius;
+        }
+        ++samples;
+        contacts += contact;
+      }
+      x = points[n].x;
+      y = points[n].y;
+    }
+    return samples? (double)contacts / samples : 0.;
+  }
+
+  //long paths for large units, ignoring and keeping their radius
+  void _benchClearance(int size, float radius)
+  {
+    constexpr int queries = 500;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(7);
+    std::vector<float> points;
+    for(int n = 0; n < queries * 4; n += 2)
+    {
+      float x, y;
+      _freePoint(*map, w, h, rng, &x, &y);
+      points.push_back(x);
+      points.push_back(y);
+    }
+
+    double ns[2] = {0., 0.};
+    double contact[2] = {0., 0.};
+    for(int pass = 0; pass < 2; ++pass)
+    {
+      std::vector<WorldGeo::PathHandle> paths(queries);
+      auto start = Clock::now();
+      for(int n = 0; n < queries; ++n)
+        paths[n] = WorldGeo::findPath(points[n * 4], points[n * 4 + 1],
+                                      points[n * 4 + 2], points[n * 4 + 3],
+                                      pass? radius : 0.f);
+      ns[pass] = std::chrono::duration<double, std::nano>(
+        Clock::now() - start).count();
+      for(int n = 0; n < queries; ++n)
+      {
+        contact[pass] += _wallContact(*map, w, h, paths[n], points[n * 4],
+                                      points[n * 4 + 1], radius);
+        WorldGeo::freePath(paths[n]);
+      }
+    }
+
+    std::printf("clearance %.2f  map %3ix%-3i  plain %8.0f ns  radius %8.0f ns"
+                "  (wall contact %.2f%% -> %.2f%%)\n", radius, size, size,
+                ns[0] / queries, ns[1] / queries, contact[0] * 100 / queries,
+                contact[1] * 100 / queries);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //cross product funnel against the angle based one on random queries
+  void _benchFunnel(int size, float radius)
+  {
+    constexpr int queries = 2000;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    double cross_ns, angle_ns;
+    int differing = WorldGeo::compareFunnels(10, queries, radius,
+                                             &cross_ns, &angle_ns);
+
+    std::printf("funnel          map %3ix%-3i  radius %.1f  cross %6.0f ns"
+                "  angles %6.0f ns  (%i/%i paths differ)\n", size, size,
+                radius, cross_ns / queries, angle_ns / queries, differing,
+                queries);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //random pushes, key decreases and pops against a plain array of keys,
+  //returns the number of pops that did not return a least key
+  int _checkHeap(unsigned seed)
+  {
+    constexpr int items = 1000;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> item_dist(0, items - 1);
+    std::uniform_int_distribution<int> key_dist(0, 10000);
+
+    Utils::CFHeap<int> heap;
+    std::vector<int> keys(items, -1);
+    int errors = 0;
+    for(int round = 0; round < 4; ++round)
+    {
+      for(int n = 0; n < 20000; ++n)
+      {
+        int item = item_dist(rng);
+        int key = key_dist(rng);
+        if(n % 3 != 2)
+        {
+          bool lower = keys[item] == -1 || key < keys[item];
+          errors += heap.update(item, key) != lower;
+          if(lower)
+            keys[item] = key;
+        }
+        else if(!heap.empty())
+        {
+          int least = *std::min_element(keys.begin(), keys.end(),
+            [](int a, int b){return (unsigned)a < (unsigned)b;});
+          errors += heap.topKey() != least || keys[heap.top()] != least;
+          keys[heap.top()] = -1;
+          heap.pop();
+        }
+      }
+      //later rounds reuse the emptied heap
+      heap.clear();
+      std::fill(keys.begin(), keys.end(), -1);
+      for(int item = 0; item < items; ++item)
+        errors += heap.contains(item);
+    }
+    return errors;
+  }
+
+  //the indexed heap against the priority queue on flat navmesh searches
+  void _benchOpenList(int size)
+  {
+    constexpr int queries = 2000;
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    double heap_ns, queue_ns, ratio;
+    int found = WorldGeo::compareOpenLists(11, queries, &heap_ns, &queue_ns,
+                                           &ratio);
+
+    int errors = _checkHeap(size);
+
+    std::printf("open list       map %3ix%-3i  heap %9.0f ns  queue %9.0f ns"
+                "  (%i/%i found, route length x%.4f, %i heap errors)\n",
+                size, size, heap_ns / queries, queue_ns / queries, found,
+                queries, ratio, errors);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //a group of units ordered to one far away destination
+  void _benchGroupMove(int size, int units)
+  {
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> offset(-3., 3.);
+    std::vector<std::pair<float, float>> starts;
+    float cx, cy, dx, dy;
+    _freePoint(*map, w, h, rng, &cx, &cy);
+    _freePoint(*map, w, h, rng, &dx, &dy);
+    while((int)starts.size() < units)
+    {
+      float x = cx + offset(rng);
+      float y = cy + offset(rng);
+      if(x > 1. && y > 1. && x < size - 1 && y < size - 1
+        && !WorldGeo::isBlocked(x, y))
+        starts.push_back({x, y});
+    }
+
+    std::vector<WorldGeo::PathHandle> paths(units);
+    auto start = Clock::now();
+    for(int n = 0; n < units; ++n)
+    {
+      paths[n] = WorldGeo::findPath(starts[n].first, starts[n].second, dx, dy,
+                                    __unit_radius);
+    }
+    auto end = Clock::now();
+    double single_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    //wall contact of the paths, to check the group keeps the radius as well
+    int single_found = 0;
+    double single_contact = 0.;
+    for(int n = 0; n < units; ++n)
+    {
+      if(paths[n] != 0)
+        single_contact += _wallContact(*map, w, h, paths[n], starts[n].first,
+                                       starts[n].second, __unit_radius);
+      single_found += _consumePath(paths[n]) != 0;
+    }
+
+    start = Clock::now();
+    WorldGeo::findGroupPaths(starts, dx, dy, __unit_radius, &paths);
+    end = Clock::now();
+    double group_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    int group_found = 0;
+    double group_contact = 0.;
+    for(int n = 0; n < units; ++n)
+    {
+      if(paths[n] != 0)
+        group_contact += _wallContact(*map, w, h, paths[n], starts[n].first,
+                                      starts[n].second, __unit_radius);
+      group_found += _consumePath(paths[n]) != 0;
+    }
+
+    std::printf("group move      map %3ix%-3i  %i units  findPath %8.0f us  "
+                "group %8.0f us  (%i/%i paths, wall contact %.2f%%/%.2f%%)\n",
+                size, size, units, single_us, group_us, group_found,
+                single_found, group_contact * 100 / std::max(group_found, 1),
+                single_contact * 100 / std::max(single_found, 1));
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+
+  //a large army ordered to one point, searched per unit against sharing
+  //one flow field, then steered along the field until every unit arrives
+  void _benchFlowField(int size, int units)
+  {
+    int w = size * 8;
+    int h = size * 8;
+
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateMap(*map, w, h, 1);
+    WorldGeo::invalidateNavMesh();
+    WorldGeo::setupNavMesh(w, h, map.get());
+
+    std::mt19937 rng(8);
+    std::uniform_real_distribution<float> offset(-6., 6.);
+    std::vector<std::pair<float, float>> starts;
+    float cx, cy, dx, dy;
+    _freePoint(*map, w, h, rng, &cx, &cy);
+    do
+      _freePoint(*map, w, h, rng, &dx, &dy);
+    while((dx - cx) * (dx - cx) + (dy - cy) * (dy - cy) < size * size / 4);
+    while((int)starts.size() < units)
+    {
+      float x = cx + offset(rng);
+      float y = cy + offset(rng);
+      if(x > 1. && y > 1. && x < size - 1 && y < size - 1
+        && !WorldGeo::isBlocked(x, y))
+        starts.push_back({x, y});
+    }
+
+    auto start = Clock::now();
+    for(auto& p: starts)
+    {
+      WorldGeo::freePath(WorldGeo::findPath(p.first, p.second, dx, dy,
+                                            __unit_radius));
+    }
+    auto end = Clock::now();
+    double path_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    std::vector<WorldGeo::FlowFieldId> fields(units);
+    start = Clock::now();
+    for(int n = 0; n < units; ++n)
+      fields[n] = WorldGeo::acquireFlowField(starts[n].first,
+                                             starts[n].second, dx, dy,
+                                             __unit_radius);
+    end = Clock::now();
+    double field_us =
+      std::chrono::duration<double, std::micro>(end - start).count();
+
+    //steer like Entity::update and finalize, units that hit an obstacle
+    //wait a tick
+    std::vector<int> hints(units, -1);
+    std::vector<bool> arrived(units, false);
+    int arrived_n = 0;
+    long samples = 0;
+    start = Clock::now();
+    for(int tick = 0; tick < size * 60 && arrived_n < units; ++tick)
+    for(int n = 0; n < units; ++n)
+    {
+      if(arrived[n])
+        continue;
+
+      float x = starts[n].first;
+      float y = starts[n].second;
+      float tx, ty;
+      bool moving = WorldGeo::sampleFlowField(fields[n], x, y, hints[n],
+                                              &tx, &ty);
+      ++samples;
+
+      if(!moving)
+      {
+        arrived[n] = true;
+        ++arrived_n;
+        continue;
+      }
+      float len = std::sqrt((tx - x) * (tx - x) + (ty - y) * (ty - y));
+      float step = std::min(len, .05f);
+      x += (tx - x) / len * step;
+      y += (ty - y) / len * step;
+      if(!WorldGeo::isBlocked(x, y, hints[n]))
+        starts[n] = {x, y};
+    }
+    end = Clock::now();
+    double tick_ns =
+      std::chrono::duration<double, std::nano>(end - start).count();
+
+    for(auto id: fields)
+      WorldGeo::releaseFlowField(id);
+
+    std::printf("flow field      map %3ix%-3i  %i units  findPath %8.0f us  "
+                "field %8.0f us  steer %5.1f ns/unit  (%i arrived)\n",
+                size, size, units, path_us, field_us, tick_ns / samples,
+                arrived_n);
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  for(int size: {64, 128, 256})
+    _benchNavMeshBuild(size);
+  for(int size: {64, 256})
+    _benchNavMeshCache(size);
+  for(int size: {64, 256})
+  {
+    _benchLocate(size);
+    _benchMovingUnits(size);
+  }
+  for(int size: {32, 64, 128, 256})
+    _benchShortPaths(size, false);
+  for(int size: {32, 64, 128, 256})
+    _benchShortPaths(size, true);
+  for(int size: {64, 128, 256})
+    _benchObstacles(size);
+  for(int size: {64, 256})
+    _checkPendingOrders(size);
+  for(int size: {64, 128, 256})
+    _benchLongPaths(size);
+  for(int size: {64, 128, 256})
+    _benchBlockedDestination(size);
+  for(int size: {64, 256})
+  {
+    _benchClearance(size, .5);
+    _benchClearance(size, 1.);
+  }
+  for(int size: {64, 256})
+  {
+    _benchFunnel(size, 0.);
+    _benchFunnel(size, .5);
+  }
+  for(int size: {64, 128, 256})
+    _benchOpenList(size);
+  _benchGroupMove(64, 200);
+  for(int units: {2, 8, 32, 200})
+    _benchGroupMove(256, units);
+  for(int size: {64, 256})
+    _benchFlowField(size, 500);
+
+  return 0;
+}
@@ -0,0 +1,323 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../src/world_geo.h"
+
+/**
+    Headless pathfinding and navmesh benchmark suite.
+    Builds blocked maps the way Terrain does, from procedural heightmaps of
+    terraces and slopes, at several sizes and seeds. Each map is measured
+    for navmesh build time, mesh size and memory, and the latency spread of
+    seeded findPath, isBlocked and pushIn queries.
+
+    Output is one JSON object per map on stdout, so runs can be diffed or
+    collected by scripts:
+      bench_suite [queries per kind] [seeds per size]
+*/
+
+namespace
+{
+  using BlockedMapT = WorldGeo::BlockedMapT;
+  using Clock = std::chrono::steady_clock;
+
+  constexpr int __default_queries = 5000;
+  constexpr int __default_seeds = 3;
+  constexpr int __max_slope = 6;          //Terrain's walkable height step
+  constexpr int __base_height = 24;
+
+  //cheap queries are timed in batches, a sample is a batch mean
+  constexpr int __blocked_batch = 64;
+  constexpr int __push_in_batch = 16;
+
+  /*
+    heightmap of overlapping mesas on a low plain, combined by maximum.
+    mesa sides are gentle ramps or cliffs steeper than Terrain walks, and a
+    few basins drop to height 0, which Terrain always blocks.
+  */
+  void _generateHeights(std::vector<uint8_t>& heights, int w, int h,
+                        unsigned seed)
+  {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pos_x(0, w - 1);
+    std::uniform_int_distribution<int> pos_y(0, h - 1);
+    std::uniform_int_distribution<int> radius(24, 96);
+    std::uniform_int_distribution<int> level(1, 5);
+    std::uniform_int_distribution<int> roll(0, 9);
+
+    heights.assign(w * h, __base_height);
+
+    int mesas = w * h / (128 * 128) * 3;
+    for(int n = 0; n < mesas; ++n)
+    {
+      int cx = pos_x(rng);
+      int cy = pos_y(rng);
+      int r = radius(rng);
+      int top = __base_height + level(rng) * 32;
+      int kind = roll(rng);
+      //walkable ramps, cliffs and basins
+      int slope = kind < 5? 2 + kind % 3 : 16;
+      if(kind == 9)
+        top = 0;
+
+      int reach = r + std::abs(top - __base_height) / slope + 1;
+      for(int y = std::max(0, cy - reach); y < std::min(h, cy + reach); ++y)
+      for(int x = std::max(0, cx - reach); x < std::min(w, cx + reach); ++x)
+      {
+        float d = std::sqrt((float)((x - cx) * (x - cx) + (y - cy) * (y - cy)));
+        float fall = std::max(0.f, d - r) * slope;
+        uint8_t& samp = heights[x + y * w];
+        if(top == 0)
+        {
+          if(d <= r)
+            samp = 0;
+          continue;
+        }
+        int height = std::max((float)__base_height, top - fall);
+        if(height > samp)
+          samp = height;
+      }
+    }
+  }
+
+  //Terrain's rule: a cell is free if it is above 0 and no neighbour
+  //differs by more than the walkable step, then lone cells are smoothed
+  void _heightsToBlockedMap(const std::vector<uint8_t>& heights,
+                            BlockedMapT& map, int w, int h)
+  {
+    map.reset();
+    for(int y = 0; y < h; ++y)
+    for(int x = 0; x < w; ++x)
+    {
+      if(x == 0 || y == 0 || x == w - 1 || y == h - 1)
+      {
+        map.set(x + y * w);
+        continue;
+      }
+      int samp = heights[x + y * w];
+      bool blocked = samp == 0;
+      for(int dy = -1; dy <= 1 && !blocked; ++dy)
+      for(int dx = -1; dx <= 1 && !blocked; ++dx)
+        blocked = std::abs(samp - heights[x + dx + (y + dy) * w]) > __max_slope;
+      if(blocked)
+        map.set(x + y * w);
+    }
+
+    for(int y = 1; y < h - 1; ++y)
+    for(int x = 1; x < w - 1; ++x)
+    {
+      int n = 0;
+      if(map[x - 1 + y * w]) n |= 0x1;
+      if(map[x + 1 + y * w]) n |= 0x2;
+      if(map[x + (y - 1) * w]) n |= 0x4;
+      if(map[x + (y + 1) * w]) n |= 0x8;
+
+      if(map[x + y * w])
+      {
+        if(!(n & 0x3) || !(n & 0xc)) map.reset(x + y * w);
+      }
+      else if((n & 0x3) == 0x3 || (n & 0xc) == 0xc) map.set(x + y * w);
+    }
+  }
+
+  //picks a random point the navmesh covers, in world units
+  void _freePoint(int size, std::mt19937& rng, float* x, float* y)
+  {
+    std::uniform_real_distribution<float> d(1., size - 1);
+    do
+    {
+      *x = d(rng);
+      *y = d(rng);
+    }while(WorldGeo::isBlocked(*x, *y));
+  }
+
+  struct __Latency
+  {
+    double p50, p99, mean;
+  };
+
+  __Latency _latency(std::vector<double>& samples)
+  {
+    __Latency latency = {0., 0., 0.};
+    if(samples.empty())
+      return latency;
+    std::sort(samples.begin(), samples.end());
+    latency.p50 = samples[samples.size() / 2];
+    latency.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    for(double sample: samples)
+      latency.mean += sample;
+    latency.mean /= samples.size();
+    return latency;
+  }
+
+  inline double _ns(Clock::time_point start, Clock::time_point end)
+  {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+  }
+
+  //resident and peak memory of the process in kB, 0 where not available
+  void _processMemory(long* rss, long* peak)
+  {
+    *rss = *peak = 0;
+    FILE* file = std::fopen("/proc/self/status", "r");
+    if(file == nullptr)
+      return;
+    char line[256];
+    while(std::fgets(line, sizeof(line), file))
+    {
+      if(std::strncmp(line, "VmRSS:", 6) == 0)
+        *rss = std::atol(line + 6);
+      else if(std::strncmp(line, "VmHWM:", 6) == 0)
+        *peak = std::atol(line + 6);
+    }
+    std::fclose(file);
+  }
+
+  void _printLatency(const char* name, int queries, __Latency latency)
+  {
+    std::printf(",\"%s\":{\"queries\":%i,\"p50_ns\":%.0f,\"p99_ns\":%.0f,"
+                "\"mean_ns\":%.0f}",
+                name, queries, latency.p50, latency.p99, latency.mean);
+  }
+
+  void _benchMap(int size, unsigned seed, int queries)
+  {
+    int w = size * 8;
+    int h = size * 8;
+
+    std::vector<uint8_t> heights;
+    std::unique_ptr<BlockedMapT> map(new BlockedMapT);
+    _generateHeights(heights, w, h, seed);
+    _heightsToBlockedMap(heights, *map, w, h);
+    size_t blocked_cells = 0;
+    for(int n = 0; n < w * h; ++n)
+      blocked_cells += (*map)[n];
+
+    WorldGeo::invalidateNavMesh();
+    auto start = Clock::now();
+    WorldGeo::setupNavMesh(w, h, map.get());
+    double build_ms = _ns(start, Clock::now()) / 1e6;
+
+    WorldGeo::NavMeshStats stats;
+    WorldGeo::getNavMeshStats(&stats);
+
+    std::mt19937 rng(seed * 7919 + size);
+    std::vector<double> samples;
+    samples.reserve(queries);
+
+    //findPath between random covered points, some on unlinked components
+    std::vector<float> points(queries * 4);
+    for(int n = 0; n < queries; ++n)
+    {
+      _freePoint(size, rng, &points[n * 4], &points[n * 4 + 1]);
+      _freePoint(size, rng, &points[n * 4 + 2], &points[n * 4 + 3]);
+    }
+    int found = 0;
+    for(int n = 0; n < queries; ++n)
+    {
+      start = Clock::now();
+      WorldGeo::PathHandle path =
+        WorldGeo::findPath(points[n * 4], points[n * 4 + 1],
+                           points[n * 4 + 2], points[n * 4 + 3]);
+      samples.push_back(_ns(start, Clock::now()));
+      if(path != 0)
+      {
+        ++found;
+        WorldGeo::freePath(path);
+      }
+    }
+    __Latency find_path = _latency(samples);
+
+    //isBlocked over the whole map
+    std::uniform_real_distribution<float> anywhere(0., size);
+    int blocked_queries = queries / __blocked_batch * __blocked_batch;
+    for(int n = 0; n < blocked_queries * 2; ++n)
+      points[n] = anywhere(rng);
+    samples.clear();
+    int blocked = 0;
+    for(int n = 0; n < blocked_queries; n += __blocked_batch)
+    {
+      start = Clock::now();
+      for(int k = n; k < n + __blocked_batch; ++k)
+        blocked += WorldGeo::isBlocked(points[k * 2], points[k * 2 + 1]);
+      samples.push_back(_ns(start, Clock::now()) / __blocked_batch);
+    }
+    __Latency is_blocked = _latency(samples);
+
+    //pushIn of units that stepped from a covered point off the navmesh
+    std::uniform_real_distribution<float> step(-1., 1.);
+    int push_in_queries = queries / __push_in_batch * __push_in_batch;
+    for(int n = 0; n < push_in_queries; ++n)
+    {
+      float x, y, tx, ty;
+      int tries = 0;
+      do
+      {
+        _freePoint(size, rng, &x, &y);
+        tx = x + step(rng);
+        ty = y + step(rng);
+      }while(!WorldGeo::isBlocked(tx, ty) && ++tries < 64);
+      points[n * 4] = tx;
+      points[n * 4 + 1] = ty;
+      points[n * 4 + 2] = x;
+      points[n * 4 + 3] = y;
+    }
+    samples.clear();
+    for(int n = 0; n < push_in_queries; n += __push_in_batch)
+    {
+      start = Clock::now();
+      for(int k = n; k < n + __push_in_batch; ++k)
+        WorldGeo::pushIn(points[k * 4], points[k * 4 + 1],
+                         points[k * 4 + 2], points[k * 4 + 3]);
+      samples.push_back(_ns(start, Clock::now()) / __push_in_batch);
+    }
+    __Latency push_in = _latency(samples);
+
+    long rss, peak;
+    _processMemory(&rss, &peak);
+
+    std::printf("{\"map_size\":%i,\"seed\":%u,\"cells\":%i,"
+                "\"blocked_cells\":%zu,\"build_ms\":%.2f,"
+                "\"vertices\":%u,\"triangles\":%u,\"plates\":%u,"
+                "\"components\":%u,\"navmesh_bytes\":%zu,"
+                "\"rss_kb\":%li,\"peak_rss_kb\":%li",
+                size, seed, w * h, blocked_cells, build_ms,
+                stats.vertices, stats.triangles, stats.plates,
+                stats.components, stats.memory, rss, peak);
+    _printLatency("find_path", queries, find_path);
+    std::printf(",\"paths_found\":%i", found);
+    _printLatency("is_blocked", blocked_queries, is_blocked);
+    std::printf(",\"blocked_hits\":%i", blocked);
+    _printLatency("push_in", push_in_queries, push_in);
+    std::printf("}\n");
+    std::fflush(stdout);
+
+    WorldGeo::deleteNavMesh();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  int queries = argc > 1? std::atoi(argv[1]) : __default_queries;
+  int seeds = argc > 2? std::atoi(argv[2]) : __default_seeds;
+  if(queries < __blocked_batch || seeds < 1)
+  {
+    std::fprintf(stderr, "usage: %s [queries >= %i] [seeds >= 1]\n",
+                 argv[0], __blocked_batch);
+    return 1;
+  }
+
+  for(int size: {64, 128, 256})
+  for(int seed = 1; seed <= seeds; ++seed)
+    _benchMap(size, seed, queries);
+
+  return 0;
+}
@@ -9,12 +9,27 @@ context ATTRIB_PASS
 
 [[VS_AP]]
 
+#ifdef _F01_Instanced
+  #ifdef GL_ARB_draw_instanced
+    #extension GL_ARB_draw_instanced : enable
+    #define INSTANCE gl_InstanceIDARB
+  #else
+    //without instancing every instance is drawn on its own
+    #define INSTANCE 0
+  #endif
+#endif
+
 attribute vec3 vertPos;
 attribute vec3 normal;
 
 uniform mat4 worldMat;
 uniform mat3 worldNormalMat;
 
+#ifdef _F01_Instanced
+//first three rows of the instance transformations, as many as InstancesPerBatch
+uniform vec4 instMatRows[64 * 3];
+#endif
+
 uniform mat4 viewProjMat;
 
 varying vec4 worldPos;
@@ -22,9 +37,22 @@ varying vec3 worldNormal;
 
 void main(void)
 {
+#ifdef _F01_Instanced
+  vec4 row0 = instMatRows[INSTANCE * 3];
+  vec4 row1 = instMatRows[INSTANCE * 3 + 1];
+  vec4 row2 = instMatRows[INSTANCE * 3 + 2];
+  mat4 instMat = mat4(row0.x, row1.x, row2.x, 0.0,
+                      row0.y, row1.y, row2.y, 0.0,
+                      row0.z, row1.z, row2.z, 0.0,
+                      row0.w, row1.w, row2.w, 1.0);
+  worldPos = worldMat * instMat * vec4(vertPos, 1.0);
+  gl_Position = viewProjMat * worldPos;
+  worldNormal = worldNormalMat * (instMat * vec4(normal, 0.0)).xyz;
+#else
   worldPos = worldMat * vec4(vertPos, 1.0);
   gl_Position = viewProjMat * worldPos;
   worldNormal = worldNormalMat * normal;
+#endif
 }
 
 [[FS_AP]]
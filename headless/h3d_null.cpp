@@ -0,0 +1,325 @@
+#include <cstring>
+#include <cstdint>
+
+#include <string>
+#include <vector>
+
+#include <horde3d.h>
+
+#include "h3d_null.h"
+
+namespace
+{
+  struct __Resource
+  {
+    int type;
+    std::string name;
+    bool loaded;
+    std::vector<uint8_t> pixels;      //texture image, as mapped by Horde3D
+  };
+
+  struct __Node
+  {
+    H3DNode parent;
+    bool live;
+    std::vector<H3DNode> children;
+    float transform[16];              //relative, column major
+  };
+
+  //handles are indices + 1, 0 is the invalid handle in both tables
+  std::vector<__Resource> _resources;
+  std::vector<__Node> _nodes;
+  unsigned _live_nodes = 0;
+
+  const float __identity[16] =
+  {
+    1., 0., 0., 0.,
+    0., 1., 0., 0.,
+    0., 0., 1., 0.,
+    0., 0., 0., 1.
+  };
+
+  inline __Resource* _resource(H3DRes res)
+  {
+    if(res <= 0 || res > (H3DRes)_resources.size())
+      return nullptr;
+    return &_resources[res - 1];
+  }
+
+  inline __Node* _node(H3DNode node)
+  {
+    if(node <= 0 || node > (H3DNode)_nodes.size() || !_nodes[node - 1].live)
+      return nullptr;
+    return &_nodes[node - 1];
+  }
+
+  H3DNode _addNode(H3DNode parent)
+  {
+    //the root is created on first use, like h3dInit would
+    if(_nodes.empty())
+    {
+      _nodes.push_back(__Node{0, true, {}, {}});
+      std::memcpy(_nodes[0].transform, __identity, sizeof(__identity));
+    }
+    if(_node(parent) == nullptr)
+      return 0;
+
+    _nodes.push_back(__Node{parent, true, {}, {}});
+    std::memcpy(_nodes.back().transform, __identity, sizeof(__identity));
+    H3DNode node = _nodes.size();
+    _nodes[parent - 1].children.push_back(node);
+    ++_live_nodes;
+    return node;
+  }
+
+  void _removeSubtree(H3DNode node)
+  {
+    __Node& removed = _nodes[node - 1];
+    removed.live = false;
+    --_live_nodes;
+    for(H3DNode child: removed.children)
+    {
+      if(_nodes[child - 1].live)
+        _removeSubtree(child);
+    }
+    removed.children.clear();
+  }
+
+  //the pixel array of an uncompressed 32 bit bitmap, the only kind of
+  //texture the simulation creates
+  void _loadBitmap(__Resource& res, const char* data, int size)
+  {
+    if(size < 54 || data[0] != 'B' || data[1] != 'M')
+      return;
+    int32_t width, height;
+    std::memcpy(&width, data + 18, 4);
+    std::memcpy(&height, data + 22, 4);
+    if(width <= 0 || height <= 0 || 54 + width * height * 4 > size)
+      return;
+    res.pixels.assign(data + 54, data + 54 + width * height * 4);
+  }
+}
+
+namespace NullRender
+{
+  unsigned liveNodes()
+  {
+    return _live_nodes;
+  }
+
+  unsigned resourceCount()
+  {
+    return _resources.size();
+  }
+}
+
+///resources
+
+H3DRes h3dAddResource(int type, const char* name, int flags)
+{
+  H3DRes res = h3dFindResource(type, name);
+  if(res != 0)
+    return res;
+  _resources.push_back(__Resource{type, name, false, {}});
+  return _resources.size();
+}
+
+H3DRes h3dFindResource(int type, const char* name)
+{
+  for(unsigned n = 0; n < _resources.size(); ++n)
+  {
+    if(_resources[n].type == type && _resources[n].name == name)
+      return n + 1;
+  }
+  return 0;
+}
+
+bool h3dLoadResource(H3DRes res, const char* data, int size)
+{
+  __Resource* resource = _resource(res);
+  if(resource == nullptr || resource->loaded)
+    return false;
+  resource->loaded = true;
+  if(resource->type == H3DResTypes::Texture && data != nullptr)
+    _loadBitmap(*resource, data, size);
+  return true;
+}
+
+void h3dUnloadResource(H3DRes res)
+{
+  __Resource* resource = _resource(res);
+  if(resource == nullptr)
+    return;
+  resource->loaded = false;
+  resource->pixels.clear();
+}
+
+bool h3dIsResLoaded(H3DRes res)
+{
+  __Resource* resource = _resource(res);
+  return resource != nullptr && resource->loaded;
+}
+
+int h3dGetResType(H3DRes res)
+{
+  __Resource* resource = _resource(res);
+  return resource != nullptr? resource->type : H3DResTypes::Undefined;
+}
+
+const char* h3dGetResName(H3DRes res)
+{
+  __Resource* resource = _resource(res);
+  return resource != nullptr? resource->name.c_str() : "";
+}
+
+H3DRes h3dGetNextResource(int type, H3DRes start)
+{
+  for(unsigned n = start < 0? 0 : start; n < _resources.size(); ++n)
+  {
+    if(type == H3DResTypes::Undefined || _resources[n].type == type)
+      return n + 1;
+  }
+  return 0;
+}
+
+H3DRes h3dQueryUnloadedResource(int index)
+{
+  for(unsigned n = 0; n < _resources.size(); ++n)
+  {
+    if(!_resources[n].loaded && index-- == 0)
+      return n + 1;
+  }
+  return 0;
+}
+
+void* h3dMapResStream(H3DRes res, int elem, int elem_idx, int stream,
+                      bool read, bool write)
+{
+  __Resource* resource = _resource(res);
+  if(resource == nullptr || resource->pixels.empty() ||
+    elem != H3DTexRes::ImageElem || stream != H3DTexRes::ImgPixelStream)
+    return nullptr;
+  return resource->pixels.data();
+}
+
+void h3dUnmapResStream(H3DRes res)
+{
+}
+
+bool h3dSetMaterialUniform(H3DRes material_res, const char* name,
+                          float a, float b, float c, float d)
+{
+  return _resource(material_res) != nullptr;
+}
+
+///scene graph
+
+H3DNode h3dAddGroupNode(H3DNode parent, const char* name)
+{
+  return _addNode(parent);
+}
+
+H3DNode h3dAddModelNode(H3DNode parent, const char* name, H3DRes geo)
+{
+  return _addNode(parent);
+}
+
+H3DNode h3dAddMeshNode(H3DNode parent, const char* name, H3DRes mat,
+                      int batch_start, int batch_count,
+                      int vert_r_start, int vert_r_end)
+{
+  return _addNode(parent);
+}
+
+H3DNode h3dAddInstancedMeshNode(H3DNode parent, const char* name,
+                                H3DRes geo, H3DRes mat,
+                                int batch_start, int batch_count,
+                                int vert_r_start, int vert_r_end)
+{
+  return _addNode(parent);
+}
+
+H3DNode h3dAddLightNode(H3DNode parent, const char* name, H3DRes mat,
+                        const char* lighting_context, const char* shadow_context)
+{
+  return _addNode(parent);
+}
+
+H3DNode h3dAddCameraNode(H3DNode parent, const char* name, H3DRes pipeline)
+{
+  return _addNode(parent);
+}
+
+void h3dRemoveNode(H3DNode node)
+{
+  if(node == H3DRootNode || _node(node) == nullptr)
+    return;
+  _removeSubtree(node);
+}
+
+void h3dSetNodeTransform(H3DNode node, float tx, float ty, float tz,
+                        float rx, float ry, float rz,
+                        float sx, float sy, float sz)
+{
+  __Node* n = _node(node);
+  if(n == nullptr)
+    return;
+  n->transform[12] = tx;
+  n->transform[13] = ty;
+  n->transform[14] = tz;
+}
+
+void h3dSetNodeTransMats(const H3DNode* nodes, const float* mats4x4,
+                        int count)
+{
+  for(int n = 0; n < count; ++n)
+  {
+    __Node* node = _node(nodes[n]);
+    if(node != nullptr)
+      std::memcpy(node->transform, mats4x4 + n * 16, sizeof(node->transform));
+  }
+}
+
+void h3dSetInstanceTransMats(H3DNode inst_mesh_node, const int* instances,
+                            const float* mats4x4, int count)
+{
+}
+
+void h3dGetNodeTransMats(H3DNode node, const float** rel_mat,
+                        const float** abs_mat)
+{
+  __Node* n = _node(node);
+  const float* mat = n != nullptr? n->transform : __identity;
+  if(rel_mat != nullptr)
+    *rel_mat = mat;
+  if(abs_mat != nullptr)
+    *abs_mat = mat;
+}
+
+void h3dSetNodeParamI(H3DNode node, int param, int value)
+{
+}
+
+int h3dGetNodeParamI(H3DNode node, int param)
+{
+  return 0;
+}
+
+void h3dSetNodeParamF(H3DNode node, int param, int comp_idx, float value)
+{
+}
+
+float h3dGetNodeParamF(H3DNode node, int param, int comp_idx)
+{
+  return 0.;
+}
+
+void h3dSetupCameraView(H3DNode camera_node, float fov, float aspect,
+                        float near_dist, float far_dist)
+{
+}
+
+void h3dGetCameraProjMat(H3DNode camera_node, float* proj_mat)
+{
+  std::memcpy(proj_mat, __identity, sizeof(__identity));
+}
@@ -0,0 +1,19 @@
+#ifndef H3D_NULL_H_INCLUDED
+#define H3D_NULL_H_INCLUDED
+
+/**
+    Null render backend. Implements the part of the Horde3D API the
+    simulation modules call, without a window or GL context: resources keep
+    their names, types and texture pixels, nodes keep their parents and
+    translations, instanced mesh nodes drop their instance transforms, and
+    nothing is ever drawn.
+*/
+
+namespace NullRender
+{
+  //nodes added and not removed yet, not counting the root
+  unsigned liveNodes();
+  unsigned resourceCount();
+}
+
+#endif // H3D_NULL_H_INCLUDED
@@ -0,0 +1,303 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/app.h"
+#include "../src/resources.h"
+#include "../src/interface.h"
+#include "../src/terrain.h"
+#include "../src/entities.h"
+#include "../src/fow.h"
+#include "../src/scenario.h"
+#include "../src/commands.h"
+
+#include "h3d_null.h"
+
+/**
+    Headless soak test. Runs Terrain, WorldGeo, Entities, FogOfWar and
+    Scenario against the null render backend, without a window or GL
+    context. A map of random plateaus is filled with units which are sent
+    to random points every few seconds of game time, and ticks run back to
+    back as fast as they can.
+
+    The orders go through Commands, so a run can be recorded and replayed,
+    like the logs the game saves after a match. A replay checks the hash of
+    every tick against the log.
+
+    Output is one JSON object on stdout:
+      dlrts_headless [--record log] [units] [ticks] [map size] [seed]
+      dlrts_headless --replay log
+*/
+
+//what the simulation modules expect of AppCtrl and Interface, without SDL
+namespace AppCtrl
+{
+  SDL_Window* screen = nullptr;
+  SDL_GLContext gl_context = nullptr;
+
+  uint16_t screen_w = 1280;
+  uint16_t screen_h = 720;
+  float screen_aspect = 1280. / 720.;
+
+  int flags = 0;
+
+  std::string app_path = "";
+
+  void dumpMessages()
+  {
+  }
+}
+
+namespace Interface
+{
+  //only called by Resources::loadAll, which has no files to load here
+  int loadFiles()
+  {
+    return 0;
+  }
+}
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  constexpr int __default_units = 2000;
+  constexpr int __default_ticks = 3600;
+  constexpr int __default_map_size = 128;
+
+  //entities come from an arena of 64 chunks of 200
+  constexpr int __max_units = 64 * 200;
+  //ticks between orders, and the share of units ordered each time
+  constexpr int __order_interval = 180;
+  constexpr int __order_share = 4;
+  //sizes of the groups ordered to one point, one for each kind of order
+  constexpr unsigned __group_sizes[] = {1, 48, 64};
+
+  struct __Latency
+  {
+    double p50, p99, mean, max;
+  };
+
+  __Latency _latency(std::vector<double>& samples)
+  {
+    __Latency latency = {0., 0., 0., 0.};
+    if(samples.empty())
+      return latency;
+    std::sort(samples.begin(), samples.end());
+    latency.p50 = samples[samples.size() / 2];
+    latency.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    latency.max = samples.back();
+    for(double sample: samples)
+      latency.mean += sample;
+    latency.mean /= samples.size();
+    return latency;
+  }
+
+  void _printLatency(const char* name, const __Latency& latency)
+  {
+    std::printf("\"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, "
+                "\"max\": %.4f}", name,
+                latency.mean, latency.p50, latency.p99, latency.max);
+  }
+
+  inline double _ms(Clock::duration duration)
+  {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  //walkable ground at height 1 with plateaus of height 2 and 3, the
+  //editor brush keeps a one tile border
+  void _generateTerrain(int size, std::mt19937& rng)
+  {
+    Commands::paintTerrain(1, 1, size - 3, 1);
+
+    std::uniform_int_distribution<int> pos(2, size - 12);
+    std::uniform_int_distribution<int> extent(2, 8);
+    std::uniform_int_distribution<int> level(2, 3);
+    for(int n = size * size / 256; n > 0; --n)
+    {
+      int x = pos(rng), y = pos(rng);
+      Commands::paintTerrain(x, y, extent(rng), level(rng));
+    }
+  }
+
+  int _placeUnits(int units, int size, std::mt19937& rng)
+  {
+    std::uniform_real_distribution<float> pos(1., size - 1.);
+    Player* player = Scenario::getPlayer(1);
+
+    int placed = 0;
+    for(int tries = units * 16; placed < units && tries > 0; --tries)
+    {
+      float x = pos(rng), y = pos(rng);
+      if(Terrain::isObstacle(x, y))
+        continue;
+      Commands::spawnUnit(x, y, player);
+      ++placed;
+    }
+    return placed;
+  }
+
+  //a share of the units is ordered to random points, in groups that
+  //take turns at single paths, group paths and flow fields
+  unsigned _issueOrders(int size, std::mt19937& rng)
+  {
+    std::uniform_real_distribution<float> pos(1., size - 1.);
+    std::uniform_int_distribution<int> pick(0, __order_share - 1);
+
+    std::vector<Entity*> group;
+    unsigned kind = 0;
+    unsigned orders = 0;
+    auto order = [&]()
+    {
+      float x = pos(rng), y = pos(rng);
+      Commands::moveUnits(group, x, y);
+      orders += group.size();
+      group.clear();
+      kind = (kind + 1) % (sizeof(__group_sizes) / sizeof(*__group_sizes));
+    };
+
+    for(auto it = Entities::getEntityStartIterator();
+      it != Entities::getEntityEndIterator(); ++it)
+    {
+      if(pick(rng) != 0)
+        continue;
+      group.push_back(*it);
+      if(group.size() == __group_sizes[kind])
+        order();
+    }
+    if(!group.empty())
+      order();
+    return orders;
+  }
+
+  //the same order AppCtrl::init brings them up in
+  void _init(const char* app_path)
+  {
+    //the navmesh cache and debug bitmaps go next to the binary
+    AppCtrl::app_path = app_path;
+    if(AppCtrl::app_path.find("/") != std::string::npos)
+      AppCtrl::app_path.erase(AppCtrl::app_path.rfind("/") + 1);
+    else AppCtrl::app_path.clear();
+
+    Resources::registerAll();
+    Terrain::init();
+    FogOfWar::init();
+    Entities::init();
+    Scenario::init();
+  }
+
+  //returns the scene nodes left behind
+  unsigned _deinit()
+  {
+    Scenario::destroy();
+    Entities::deinit();
+    Terrain::deinit();
+    return NullRender::liveNodes();
+  }
+
+  int _replay(const char* path)
+  {
+    if(!Commands::loadLog(path))
+    {
+      std::fprintf(stderr, "unable to load \"%s\"\n", path);
+      return 1;
+    }
+
+    Commands::ReplayResult result;
+    Commands::replay(&result);
+    unsigned nodes = _deinit();
+
+    std::printf("{\"replay\": \"%s\", \"ticks\": %u, \"commands\": %u, "
+                "\"ms\": %.1f, \"ticks_per_s\": %.1f, \"first_mismatch\": %i, "
+                "\"scene_nodes_left\": %u}\n",
+                path, result.ticks, result.commands, result.ms,
+                result.ticks * 1000. / result.ms, result.first_mismatch, nodes);
+    return result.first_mismatch == -1? 0 : 1;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  _init(argv[0]);
+
+  if(argc == 3 && std::strcmp(argv[1], "--replay") == 0)
+    return _replay(argv[2]);
+
+  const char* record_path = nullptr;
+  int arg = 1;
+  if(argc > 2 && std::strcmp(argv[1], "--record") == 0)
+  {
+    record_path = argv[2];
+    arg = 3;
+  }
+
+  int units = argc > arg? std::atoi(argv[arg]) : __default_units;
+  int ticks = argc > arg + 1? std::atoi(argv[arg + 1]) : __default_ticks;
+  int size = argc > arg + 2? std::atoi(argv[arg + 2]) : __default_map_size;
+  unsigned seed = argc > arg + 3? std::atoi(argv[arg + 3]) : 1;
+  if(units < 1 || units > __max_units || ticks < 1 || size < 16 || size > 256)
+  {
+    std::fprintf(stderr, "usage: %s [--record log] [units <= %i] [ticks] "
+                 "[map size 16-256] [seed]\n       %s --replay log\n",
+                 argv[0], __max_units, argv[0]);
+    return 1;
+  }
+
+  std::mt19937 rng(seed);
+
+  Clock::time_point begin = Clock::now();
+  Scenario::create(size, size);
+  _generateTerrain(size, rng);
+  int placed = _placeUnits(units, size, rng);
+  Commands::startMatch();
+  double setup_ms = _ms(Clock::now() - begin);
+
+  std::vector<double> tick_samples, present_samples;
+  tick_samples.reserve(ticks);
+  present_samples.reserve(ticks);
+  unsigned orders = 0;
+
+  begin = Clock::now();
+  for(int tick = 0; tick < ticks; ++tick)
+  {
+    if(tick % __order_interval == 0)
+      orders += _issueOrders(size, rng);
+
+    Clock::time_point tick_begin = Clock::now();
+    Scenario::tick();
+    Clock::time_point present_begin = Clock::now();
+    Entities::syncTransforms(1.);
+    Scenario::present();
+    Clock::time_point end = Clock::now();
+
+    tick_samples.push_back(_ms(present_begin - tick_begin));
+    present_samples.push_back(_ms(end - present_begin));
+  }
+  double total_ms = _ms(Clock::now() - begin);
+
+  Commands::endMatch();
+  if(record_path != nullptr && !Commands::saveLog(record_path))
+    return 1;
+  unsigned nodes = _deinit();
+
+  std::printf("{\"units\": %i, \"ticks\": %i, \"map\": %i, \"seed\": %u, "
+              "\"orders\": %u, \"setup_ms\": %.1f, \"ticks_per_s\": %.1f, ",
+              placed, ticks, size, seed, orders, setup_ms,
+              ticks * 1000. / total_ms);
+  __Latency tick_latency = _latency(tick_samples);
+  __Latency present_latency = _latency(present_samples);
+  _printLatency("tick_ms", tick_latency);
+  std::printf(", ");
+  _printLatency("present_ms", present_latency);
+  std::printf(", \"scene_nodes_left\": %u}\n", nodes);
+
+  return 0;
+}
@@ -0,0 +1,381 @@
+#include <cstdio>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+#include "terrain.h"
+#include "world_geo.h"
+#include "entities.h"
+#include "fow.h"
+#include "scenario.h"
+
+#include "commands.h"
+
+namespace
+{
+  enum: uint8_t
+  {
+    __move,
+    __spawn,
+    __light,
+    __paint,
+    __slope,
+    __start,
+    __end
+  };
+
+  struct __Command
+  {
+    uint32_t tick;
+    uint8_t type;
+    uint8_t level;            //terrain height or slope direction
+    uint16_t player;          //player flag
+    int16_t tile_x, tile_y, size;
+    float x, y, range;
+    uint32_t first_unit, units;   //handles of the ordered units in the log
+  };
+
+  struct __Log
+  {
+    uint16_t width, height;
+    std::vector<__Command> commands;
+    std::vector<Entities::EntityHandle> units;
+    std::vector<uint64_t> hashes;       //after tick n + 1
+
+    void clear(uint16_t w, uint16_t h)
+    {
+      width = w;
+      height = h;
+      commands.clear();
+      units.clear();
+      hashes.clear();
+    }
+  };
+
+  __Log _log;
+  __Log _playback;
+
+  constexpr uint32_t __log_magic = 0x50524c44;    //"DLRP"
+  constexpr uint32_t __log_version = 1;
+
+  struct __LogHeader
+  {
+    uint32_t magic, version;
+    uint16_t width, height;
+    uint32_t num_commands, num_units, num_hashes;
+  };
+
+  //groups at least this large share one search, smaller ones request a
+  //path per unit on the path workers, which is faster on cross map orders
+  //while the group search runs over the flat navmesh
+  constexpr unsigned __group_search_size = 48;
+  //groups at least this large steer along a shared flow field
+  constexpr unsigned __flow_field_group_size = 64;
+
+  //group move scratch
+  std::vector<std::pair<float, float>> _group_starts;
+  std::vector<WorldGeo::PathHandle> _group_paths;
+  std::vector<Entity*> _ordered_units;
+
+  inline __Command _newCommand(uint8_t type)
+  {
+    __Command command = {};
+    command.tick = Scenario::ticksLapsed();
+    command.type = type;
+    return command;
+  }
+
+  uint16_t _playerFlag(Player* player)
+  {
+    for(int idx = 0; idx < 16; ++idx)
+    {
+      if(Scenario::getPlayer(1 << idx) == player)
+        return 1 << idx;
+    }
+    return 0;
+  }
+
+  void _moveUnits(const std::vector<Entity*>& units, float x, float y)
+  {
+    if(units.size() < __group_search_size)
+    {
+      for(Entity* unit: units)
+        unit->issueMoveCommand(x, y);
+      return;
+    }
+
+    //the group keeps clear enough for its largest unit
+    float radius = 0.;
+    for(Entity* unit: units)
+      radius = std::max(radius, unit->getRadius());
+
+    if(units.size() >= __flow_field_group_size)
+    {
+      for(Entity* unit: units)
+        unit->issueFlowCommand(x, y, radius);
+      return;
+    }
+
+    //groups share one search
+    _group_starts.clear();
+    for(Entity* unit: units)
+    {
+      float x_pos, y_pos;
+      unit->getPosition(&x_pos, &y_pos);
+      _group_starts.push_back({x_pos, y_pos});
+    }
+    WorldGeo::findGroupPaths(_group_starts, x, y, radius, &_group_paths);
+    for(unsigned n = 0; n < units.size(); ++n)
+      units[n]->issueMoveCommand(_group_paths[n]);
+  }
+
+  void _execute(const __Command& command, const __Log& log)
+  {
+    switch(command.type)
+    {
+      case __move:
+      _ordered_units.clear();
+      for(uint32_t n = 0; n < command.units; ++n)
+      {
+        Entity* unit = Entities::getEntity(log.units[command.first_unit + n]);
+        if(unit != nullptr)
+          _ordered_units.push_back(unit);
+      }
+      if(!_ordered_units.empty())
+        Commands::moveUnits(_ordered_units, command.x, command.y);
+      break;
+
+      case __spawn:
+      Commands::spawnUnit(command.x, command.y,
+                          Scenario::getPlayer(command.player));
+      break;
+
+      case __light:
+      Commands::placeLight(command.x, command.y, command.range);
+      break;
+
+      case __paint:
+      Commands::paintTerrain(command.tile_x, command.tile_y, command.size,
+                             command.level);
+      break;
+
+      case __slope:
+      Commands::addSlope(command.tile_x, command.tile_y, command.level);
+      break;
+
+      case __start:
+      Commands::startMatch();
+      break;
+
+      case __end:
+      Commands::endMatch();
+      break;
+
+      default: break;
+    }
+  }
+
+  template<class T>
+  inline bool _write(FILE* file, const std::vector<T>& data)
+  {
+    return fwrite(data.data(), sizeof(T), data.size(), file) == data.size();
+  }
+
+  template<class T>
+  inline bool _read(FILE* file, std::vector<T>& data, uint32_t size)
+  {
+    data.resize(size);
+    return fread(data.data(), sizeof(T), size, file) == size;
+  }
+}
+
+namespace Commands
+{
+  ///orders
+
+  void moveUnits(const std::vector<Entity*>& units, float x, float y)
+  {
+    if(units.empty())
+      return;
+
+    __Command command = _newCommand(__move);
+    command.x = x;
+    command.y = y;
+    command.first_unit = _log.units.size();
+    command.units = units.size();
+    for(Entity* unit: units)
+      _log.units.push_back(unit->getHandle());
+    _log.commands.push_back(command);
+
+    _moveUnits(units, x, y);
+  }
+
+  void spawnUnit(float x, float y, Player* player)
+  {
+    __Command command = _newCommand(__spawn);
+    command.x = x;
+    command.y = y;
+    command.player = _playerFlag(player);
+    _log.commands.push_back(command);
+
+    Entities::insertEntity(x, y, player);
+  }
+
+  void placeLight(float x, float y, float range)
+  {
+    __Command command = _newCommand(__light);
+    command.x = x;
+    command.y = y;
+    command.range = range;
+    _log.commands.push_back(command);
+
+    FogOfWar::insertLightSource(x, y, range);
+  }
+
+  void paintTerrain(int16_t x, int16_t y, int16_t size, uint8_t height)
+  {
+    __Command command = _newCommand(__paint);
+    command.tile_x = x;
+    command.tile_y = y;
+    command.size = size;
+    command.level = height;
+    _log.commands.push_back(command);
+
+    Terrain::modifyDistanceFieldMap(x, y, size, size, height);
+    Entities::invalidateHeights();
+  }
+
+  void addSlope(uint16_t x, uint16_t y, uint16_t type)
+  {
+    __Command command = _newCommand(__slope);
+    command.tile_x = x;
+    command.tile_y = y;
+    command.level = type;
+    _log.commands.push_back(command);
+
+    Terrain::addSlope(x, y, type);
+    Entities::invalidateHeights();
+  }
+
+  void startMatch()
+  {
+    _log.commands.push_back(_newCommand(__start));
+    Scenario::start();
+  }
+
+  void endMatch()
+  {
+    _log.commands.push_back(_newCommand(__end));
+    Scenario::end();
+  }
+
+  ///log
+
+  void beginLog(uint16_t w, uint16_t h)
+  {
+    _log.clear(w, h);
+  }
+
+  void recordTick()
+  {
+    _log.hashes.push_back(Entities::hashState());
+  }
+
+  bool saveLog(const char* path)
+  {
+    __LogHeader header;
+    header.magic = __log_magic;
+    header.version = __log_version;
+    header.width = _log.width;
+    header.height = _log.height;
+    header.num_commands = _log.commands.size();
+    header.num_units = _log.units.size();
+    header.num_hashes = _log.hashes.size();
+
+    FILE* file = fopen(path, "wb");
+    if(file == nullptr)
+    {
+      printf("Unable to write file \"%s\"\n", path);
+      return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+      && _write(file, _log.commands)
+      && _write(file, _log.units)
+      && _write(file, _log.hashes);
+    return fclose(file) == 0 && ok;
+  }
+
+  bool loadLog(const char* path)
+  {
+    FILE* file = fopen(path, "rb");
+    if(file == nullptr)
+      return false;
+
+    __LogHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+      && header.magic == __log_magic && header.version == __log_version;
+    if(ok)
+    {
+      _playback.clear(header.width, header.height);
+      ok = _read(file, _playback.commands, header.num_commands)
+        && _read(file, _playback.units, header.num_units)
+        && _read(file, _playback.hashes, header.num_hashes);
+    }
+    fclose(file);
+
+    //ordered units have to be in the log
+    for(const __Command& command: _playback.commands)
+    {
+      ok = ok && (uint64_t)command.first_unit + command.units
+                 <= _playback.units.size();
+    }
+    if(!ok)
+      _playback.clear(0, 0);
+    return ok;
+  }
+
+  bool replay(ReplayResult* result)
+  {
+    if(_playback.width == 0)
+      return false;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point begin = Clock::now();
+
+    //the recorded game started from a new map as well
+    Scenario::create(_playback.width, _playback.height);
+
+    result->ticks = _playback.hashes.size();
+    result->commands = _playback.commands.size();
+    result->first_mismatch = -1;
+
+    unsigned next = 0;
+    for(unsigned tick = 0; tick < _playback.hashes.size(); ++tick)
+    {
+      while(next < _playback.commands.size() &&
+        _playback.commands[next].tick == tick)
+      {
+        _execute(_playback.commands[next++], _playback);
+      }
+
+      Scenario::proceed();
+
+      if(result->first_mismatch == -1 &&
+        _log.hashes.back() != _playback.hashes[tick])
+      {
+        result->first_mismatch = tick;
+      }
+    }
+    //orders after the last tick, like ending the match
+    while(next < _playback.commands.size())
+      _execute(_playback.commands[next++], _playback);
+
+    result->ms = std::chrono::duration<double, std::milli>
+      (Clock::now() - begin).count();
+    return true;
+  }
+}
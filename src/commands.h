@@ -0,0 +1,47 @@
+#ifndef COMMANDS_H_INCLUDED
+#define COMMANDS_H_INCLUDED
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "entities.h"
+#include "player.h"
+
+/*
+  every order that changes the simulation goes through here, stamped with
+  the tick it is issued before. the log also keeps a hash of the entity
+  positions after every tick, so playing a log back from a new map has to
+  give the same hashes at the same ticks.
+*/
+namespace Commands
+{
+  //orders
+  void moveUnits(const std::vector<Entity*>&, float, float);
+  void spawnUnit(float, float, Player*);
+  void placeLight(float, float, float);
+  //arguments: (tile x, tile y, size, height)
+  void paintTerrain(int16_t, int16_t, int16_t, uint8_t);
+  void addSlope(uint16_t, uint16_t, uint16_t);
+  void startMatch();
+  void endMatch();
+
+  //the log is restarted by Scenario::create, every tick appends its hash
+  void beginLog(uint16_t, uint16_t);
+  void recordTick();
+  bool saveLog(const char*);
+  bool loadLog(const char*);
+
+  struct ReplayResult
+  {
+    unsigned ticks, commands;
+    int first_mismatch;       //first tick with another hash, -1 if none
+    double ms;
+  };
+
+  //plays the loaded log back through Scenario::proceed as fast as ticks
+  //run. the scenario has to be initialized with no map created yet
+  bool replay(ReplayResult*);
+}
+
+#endif // COMMANDS_H_INCLUDED
@@ -3,6 +3,10 @@
 #include <csignal>
 
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include <horde3d.h>
 
@@ -27,26 +31,306 @@ namespace
   H3DRes _cube_geo;
   H3DRes _cube_mat;
 
+  //every unit is an instance of this node, at the index of its handle - 1.
+  //there are as many instances as handles, freed ones are collapsed. an
+  //entity only gets a node of its own while something is attached to it
+  H3DNode _unit_node = 0;
+  uint32_t _unit_instances = 0;
+
+  const float __collapsed[16] = {};
+
   Utils::ArenaAllocator<sizeof(Entity), 200> _entity_allocator;
 
   std::vector<Entity*> _entities;
   uint32_t _entity_count = 0;         //the entity count must always be updated
+
+  /*
+    the state every tick walks through, one array per field. index n of
+    every array belongs to _entities[n], the rest of an entity stays in its
+    Entity object. indices shift down when entities before them are
+    removed, _entity_slots maps the handle of an entity to its index.
+  */
+  struct __EntityStore
+  {
+    std::vector<_vec3_t> pos;
+    std::vector<_vec2_t> next_pos;
+    std::vector<_vec2_t> target;
+    std::vector<WorldGeo::PathHandle> path;
+    std::vector<unsigned> path_step;        //next waypoint
+    std::vector<WorldGeo::FlowFieldId> flow_field;
+    std::vector<int> nav_triangle;          //navmesh location hint
+    std::vector<float> radius;              //paths keep this far from obstacles
+    std::vector<Entities::EntityHandle> handle;
+
+    void move(uint32_t from, uint32_t to)
+    {
+      pos[to] = pos[from];
+      next_pos[to] = next_pos[from];
+      target[to] = target[from];
+      path[to] = path[from];
+      path_step[to] = path_step[from];
+      flow_field[to] = flow_field[from];
+      nav_triangle[to] = nav_triangle[from];
+      radius[to] = radius[from];
+      handle[to] = handle[from];
+    }
+
+    void resize(uint32_t size)
+    {
+      pos.resize(size);
+      next_pos.resize(size);
+      target.resize(size);
+      path.resize(size);
+      path_step.resize(size);
+      flow_field.resize(size);
+      nav_triangle.resize(size);
+      radius.resize(size);
+      handle.resize(size);
+    }
+  };
+
+  __EntityStore _store;
+  std::vector<uint32_t> _entity_slots;        //index of handle - 1
+  constexpr uint32_t __free_slot = UINT32_MAX;
+  //a min heap, so the lowest handle is reused first and the unit instances
+  //stay packed. handles trimmed off the end can be left in it, also after
+  //they were handed out again, these are skipped
+  std::vector<Entities::EntityHandle> _free_handles;
+
+  /*
+    the scene graph is only touched by the thread that renders. every tick
+    the positions an entity moved between go to the back buffer, which is
+    swapped to the front at the end of the tick. syncTransforms blends
+    between the two positions of the front buffer. several ticks can pass
+    between two syncs, so an entity stays in the buffer until its last
+    position has been synced, idle entities are left out.
+  */
+  struct __Transform
+  {
+    H3DNode node;         //0 if the entity has no node
+    int instance;
+    uint32_t entity;      //index in the store, both buffers are in this order
+    float from[3];
+    float to[3];
+  };
+
+  std::vector<__Transform> _transforms[2];
+  unsigned _front_transforms = 0;
+  std::mutex _transform_mutex;
+  float _synced_alpha = -1.;          //of the front buffer, -1 if not synced
+
+  //whether the scene graph may still lag behind the entry
+  inline bool _transformPending(const __Transform& transform, float synced_alpha)
+  {
+    if(synced_alpha == 1.)
+      return false;
+    return synced_alpha < 0. ||
+      !std::equal(transform.from, transform.from + 3, transform.to);
+  }
+
+  //matrices for h3dSetInstanceTransMats and h3dSetNodeTransMats,
+  //translation only
+  std::vector<int> _sync_instances;
+  std::vector<float> _sync_mats;
+  std::vector<H3DNode> _sync_nodes;
+  std::vector<float> _sync_node_mats;
+
+  inline void _translationMatrix(float* mat, const float* pos)
+  {
+    std::fill(mat, mat + 16, 0.f);
+    mat[0] = mat[5] = mat[10] = mat[15] = 1.;
+    for(int i = 0; i < 3; ++i)
+      mat[12 + i] = pos[i];
+  }
+
+  //horde3d hands the handles of removed nodes out again, so no entry may
+  //name a removed node. the back buffer is only written during a tick
+  void _forgetNode(H3DNode node)
+  {
+    std::lock_guard<std::mutex> lock(_transform_mutex);
+    for(std::vector<__Transform>& transforms: _transforms)
+    {
+      for(__Transform& transform: transforms)
+      {
+        if(transform.node == node)
+          transform.node = 0;
+      }
+    }
+  }
+
+  void _clearTransforms()
+  {
+    std::lock_guard<std::mutex> lock(_transform_mutex);
+    _transforms[0].clear();
+    _transforms[1].clear();
+    _synced_alpha = -1.;
+  }
+
+  //maximum number of paths handed to entities per tick
+  constexpr unsigned __path_budget = 64;
+
+  constexpr float __unit_radius = .25;
+  //steps a pushed in position may take back towards the last one
+  constexpr int __max_halvings = 16;
+
+  /*
+    broadphase for pushing units apart. units are counting sorted into
+    hashed buckets of square cells as wide as the largest separation
+    distance, so a unit only needs to be tested against the units of its
+    own and the eight surrounding cells. entities keep their order within
+    a bucket, and the neighbours of a unit are tested in entity order, which
+    keeps the order of the pushes fixed from run to run.
+  */
+  struct __GridEntry
+  {
+    int32_t x, y;       //cell
+    uint32_t entity;
+  };
+
+  std::vector<uint32_t> _grid_ofsets;        //bucket starts in _grid_entries
+  std::vector<__GridEntry> _grid_entries;
+  std::vector<__GridEntry> _grid_cells;      //cell of every entity
+  std::vector<uint32_t> _grid_neighbours;
+  uint32_t _grid_mask = 0;
+
+  inline uint32_t _gridBucket(int32_t x, int32_t y)
+  {
+    return ((uint32_t)x * 0x9e3779b1u ^ (uint32_t)y * 0x85ebca77u) & _grid_mask;
+  }
+
+  inline int32_t _gridCoord(_ctype_t v, int32_t cell_size)
+  {
+    return v.num >= 0? v.num / cell_size : (v.num + 1) / cell_size - 1;
+  }
+
+  //sorts the entities into the buckets, _grid_cells has to be filled
+  void _buildGrid()
+  {
+    uint32_t count = _grid_cells.size();
+    uint32_t buckets = 16;
+    while(buckets < count * 2)
+      buckets <<= 1;
+    _grid_mask = buckets - 1;
+
+    _grid_ofsets.assign(buckets + 1, 0);
+    for(auto& cell: _grid_cells)
+      ++_grid_ofsets[_gridBucket(cell.x, cell.y) + 1];
+    for(uint32_t b = 0; b < buckets; ++b)
+      _grid_ofsets[b + 1] += _grid_ofsets[b];
+
+    _grid_entries.resize(count);
+    for(auto& cell: _grid_cells)
+      _grid_entries[_grid_ofsets[_gridBucket(cell.x, cell.y)]++] = cell;
+    //the fill moved every start to the next bucket's
+    for(uint32_t b = buckets; b > 0; --b)
+      _grid_ofsets[b] = _grid_ofsets[b - 1];
+    _grid_ofsets[0] = 0;
+  }
+
+  //lists the entities after entity in the surrounding cells, in order
+  void _listNeighbours(uint32_t entity)
+  {
+    _grid_neighbours.clear();
+    const __GridEntry& center = _grid_cells[entity];
+    for(int32_t y = center.y - 1; y <= center.y + 1; ++y)
+    for(int32_t x = center.x - 1; x <= center.x + 1; ++x)
+    {
+      uint32_t bucket = _gridBucket(x, y);
+      for(uint32_t e = _grid_ofsets[bucket]; e < _grid_ofsets[bucket + 1]; ++e)
+      {
+        const __GridEntry& other = _grid_entries[e];
+        //other cells can share the bucket
+        if(other.entity > entity && other.x == x && other.y == y)
+          _grid_neighbours.push_back(other.entity);
+      }
+    }
+    std::sort(_grid_neighbours.begin(), _grid_neighbours.end());
+  }
   
-  inline void _removenullptrEntities()
+  inline void _resizeInstances()
+  {
+    if(_unit_instances == _entity_slots.size())
+      return;
+    _unit_instances = _entity_slots.size();
+    h3dSetNodeParamI(_unit_node, H3DInstancedMesh::InstanceCountI, _unit_instances);
+  }
+
+  //collapses the instance of the handle, the range of handles and with it
+  //the instance count shrinks when the highest ones are freed
+  void _freeHandle(Entities::EntityHandle handle)
   {
-    std::vector<Entity*>::iterator stepper;
-    std::vector<Entity*>::iterator it;
+    int instance = handle - 1;
+    h3dSetInstanceTransMats(_unit_node, &instance, __collapsed, 1);
+    _entity_slots[handle - 1] = __free_slot;
+
+    if(handle != _entity_slots.size())
+    {
+      _free_handles.push_back(handle);
+      std::push_heap(_free_handles.begin(), _free_handles.end(),
+                     std::greater<Entities::EntityHandle>());
+      return;
+    }
+    while(!_entity_slots.empty() && _entity_slots.back() == __free_slot)
+      _entity_slots.pop_back();
+    if(_entity_slots.empty())
+      _free_handles.clear();
+    _resizeInstances();
+  }
 
-    for(stepper = it = _entities.begin(); it != _entities.end(); ++it)
+  //adds the entity at the end of the store, returns its handle
+  Entities::EntityHandle _appendEntity(Entity* entity, _ctype_t x, _ctype_t y)
+  {
+    Entities::EntityHandle handle = 0;
+    while(handle == 0 && !_free_handles.empty())
+    {
+      std::pop_heap(_free_handles.begin(), _free_handles.end(),
+                    std::greater<Entities::EntityHandle>());
+      Entities::EntityHandle free = _free_handles.back();
+      _free_handles.pop_back();
+      if(free <= _entity_slots.size() && _entity_slots[free - 1] == __free_slot)
+        handle = free;
+    }
+    if(handle == 0)
     {
-      if(*it != nullptr)
+      _entity_slots.push_back(0);
+      handle = _entity_slots.size();
+    }
+    _entity_slots[handle - 1] = _entities.size();
+    _resizeInstances();
+
+    _entities.push_back(entity);
+    _store.pos.push_back(_vec3_t(x, _ctype_t(0), y));
+    _store.next_pos.push_back(_vec2_t(x, y));
+    _store.target.push_back(_vec2_t(x, y));
+    _store.path.push_back(0);
+    _store.path_step.push_back(0);
+    _store.flow_field.push_back(0);
+    _store.nav_triangle.push_back(-1);
+    _store.radius.push_back(__unit_radius);
+    _store.handle.push_back(handle);
+    return handle;
+  }
+
+  //the order of the remaining entities is kept
+  inline void _removenullptrEntities()
+  {
+    uint32_t kept = 0;
+    for(uint32_t n = 0; n < _entities.size(); ++n)
+    {
+      if(_entities[n] == nullptr)
+        continue;
+      if(kept != n)
       {
-        *stepper = *it;
-        ++stepper;
+        _entities[kept] = _entities[n];
+        _store.move(n, kept);
+        _entity_slots[_store.handle[kept] - 1] = kept;
       }
+      ++kept;
     }
 
     _entities.resize(_entity_count);
+    _store.resize(_entity_count);
+    _clearTransforms();
   }
 
   inline void _removeEntity(Entity** entity)
@@ -55,37 +339,257 @@ namespace
     *entity = nullptr;
     --_entity_count;
   }
+
+  ///batch passes over the store
+
+  /*
+    passes over independent entities are split into ranges over the
+    workers. a pass only writes the entries of its own range and calls
+    into WorldGeo and Terrain read only, so the results do not depend on
+    how the ranges are run. everything shared, like freeing paths, vision
+    and the scene graph, is done on the calling thread in entity order.
+  */
+  std::unique_ptr<Utils::ThreadPool> _entity_workers;
+  constexpr unsigned __entity_chunk = 256;
+
+  //paths and flow fields finished in a parallel pass, freed after it
+  enum: uint8_t
+  {
+    __release_flow_field = 1,
+    __release_path = 2
+  };
+  std::vector<uint8_t> _releases;
+  std::vector<_ctype_t> _next_heights;
+  //the terrain changed, entities that stand still need new heights too
+  bool _heights_stale = false;
+
+  template<class F>
+  void _forEachEntity(F pass)
+  {
+    if(_entity_workers)
+      _entity_workers->parallelFor(_entities.size(), __entity_chunk, pass);
+    else pass(0, _entities.size());
+  }
+
+  //moves the targets along their paths or flow fields
+  void _updateTargets(uint32_t begin, uint32_t end)
+  {
+    constexpr _ctype_t margin(0.1);
+
+    for(uint32_t n = begin; n < end; ++n)
+    {
+      _releases[n] = 0;
+      const _vec3_t& pos = _store.pos[n];
+      _vec2_t& target = _store.target[n];
+      WorldGeo::FlowFieldId& flow_field = _store.flow_field[n];
+      WorldGeo::PathHandle& path = _store.path[n];
+
+      if(flow_field)
+      {
+        float x, y;
+        if(WorldGeo::sampleFlowField(flow_field, (float)pos.x, (float)pos.z,
+                                     _store.nav_triangle[n], &x, &y))
+        {
+          target.x = _ctype_t(x);
+          target.y = _ctype_t(y);
+          continue;
+        }
+        _releases[n] |= __release_flow_field;
+      }
+
+      if(path == 0)
+      {
+        target.x = pos.x;
+        target.y = pos.z;
+        continue;
+      }
+      unsigned length;
+      const PathPoint& point =
+        WorldGeo::getPath(path, &length)[_store.path_step[n]];
+      target.x = _ctype_t(point.x);
+      target.y = _ctype_t(point.y);
+
+      if((pos.x - target.x).abs() < margin && (pos.z - target.y).abs() < margin
+        && ++_store.path_step[n] == length)
+        _releases[n] |= __release_path;
+    }
+  }
+
+  void _releaseFinished()
+  {
+    for(uint32_t n = 0; n < _entities.size(); ++n)
+    {
+      if(_releases[n] & __release_flow_field)
+      {
+        WorldGeo::releaseFlowField(_store.flow_field[n]);
+        _store.flow_field[n] = 0;
+      }
+      if(_releases[n] & __release_path)
+      {
+        WorldGeo::freePath(_store.path[n]);
+        _store.path[n] = 0;
+      }
+    }
+  }
+
+  //steps the entities towards their targets
+  void _stepEntities(uint32_t begin, uint32_t end)
+  {
+    for(uint32_t n = begin; n < end; ++n)
+    {
+      const _vec3_t& pos = _store.pos[n];
+      _vec2_t direction = _store.target[n] - _vec2_t(pos.x, pos.z);
+      direction = direction.normalize() / 20;
+      //                                  ^
+      //that is a constant which controls movement speed(horrible magic numbers)
+      _store.next_pos[n].x = pos.x + direction.x;
+      _store.next_pos[n].y = pos.z + direction.y;
+    }
+  }
+
+  void _pushApart(uint32_t first, uint32_t second)
+  {
+    _vec2_t& first_pos = _store.next_pos[first];
+    _vec2_t& second_pos = _store.next_pos[second];
+    float distance = _store.radius[first] + _store.radius[second];
+    if((float)(second_pos - first_pos).magnitudeSquared()
+      > distance * distance)
+      return;
+
+    _vec2_t vec = (second_pos - first_pos).normalize()
+                  * _ctype_t(distance / 2);
+    _vec2_t center = (second_pos + first_pos) / 2;
+    second_pos = center + vec;
+    first_pos = center - vec;
+  }
+
+  //pulls next positions that left the navmesh back onto it
+  void _keepOnNavMesh(uint32_t begin, uint32_t end)
+  {
+    for(uint32_t n = begin; n < end; ++n)
+    {
+      const _vec3_t& pos = _store.pos[n];
+      _vec2_t& next_pos = _store.next_pos[n];
+      int& nav_triangle = _store.nav_triangle[n];
+
+      float x = (float)next_pos.x;
+      float y = (float)next_pos.y;
+      if(WorldGeo::isBlocked(x, y, nav_triangle))
+      {
+        WorldGeo::pushIn(x, y, (float)pos.x, (float)pos.z, nav_triangle);
+        next_pos.x = x;
+        next_pos.y = y;
+
+        //halving towards a last position that was off the mesh as well
+        //would never end
+        int halvings = 0;
+        while(WorldGeo::isBlocked((float)next_pos.x, (float)next_pos.y,
+                                  nav_triangle))
+        {
+          if(++halvings > __max_halvings)
+          {
+            next_pos.x = pos.x;
+            next_pos.y = pos.z;
+            break;
+          }
+          next_pos.x = pos.x + (next_pos.x - pos.x) / 2;
+          next_pos.y = pos.z + (next_pos.y - pos.z) / 2;
+        }
+      }
+    }
+  }
+
+  void _sampleHeights(uint32_t begin, uint32_t end)
+  {
+    for(uint32_t n = begin; n < end; ++n)
+    {
+      const _vec3_t& pos = _store.pos[n];
+      const _vec2_t& next_pos = _store.next_pos[n];
+      if(!_heights_stale && next_pos.x == pos.x && next_pos.y == pos.z)
+      {
+        _next_heights[n] = pos.y;
+        continue;
+      }
+      _next_heights[n] =
+        (_ctype_t)Terrain::heightf((double)next_pos.x, (double)next_pos.y);
+    }
+  }
 }
 
 ///Entity class
 
 //protected functions
-void Entity::_updateTarget()
+uint32_t Entity::_index() const
 {
-  constexpr _ctype_t margin(0.1);
+  return _entity_slots[_handle - 1];
+}
 
-  if(_path_node == nullptr)
+const _vec3_t& Entity::_position() const
+{
+  return _store.pos[_index()];
+}
+
+//moves every entity to its next position and sampled height, vision
+//follows, the scene graph waits for syncTransforms
+void Entity::_finalizeAll()
+{
+  const std::vector<__Transform>& front = _transforms[_front_transforms];
+  std::vector<__Transform>& back = _transforms[1 - _front_transforms];
+  back.clear();
+
+  //the render thread only reads the front buffer. a sync after this only
+  //means an entry is carried over once more than needed
+  float synced_alpha;
   {
-    _target.x = _pos.x;
-    _target.y = _pos.z;
-    return;
+    std::lock_guard<std::mutex> lock(_transform_mutex);
+    synced_alpha = _synced_alpha;
   }
-  _target.x = _ctype_t(_path_node->x);
-  _target.y = _ctype_t(_path_node->y);
+  unsigned carried = 0;
 
-  if((_pos.x - _target.x).abs() < margin && (_pos.z - _target.y).abs() < margin)
-    _path_node = _path_node->advance();
+  for(uint32_t n = 0; n < _entities.size(); ++n)
+  {
+    _vec3_t& pos = _store.pos[n];
+    const _vec2_t& next_pos = _store.next_pos[n];
+
+    //update vision if entity changes tiles
+    if((int)next_pos.x != (int)pos.x || (int)next_pos.y != (int)pos.z)
+      _entities[n]->_updateVision();
+
+    _vec3_t last_pos = pos;
+    pos.x = next_pos.x;
+    pos.y = _next_heights[n];
+    pos.z = next_pos.y;
+
+    //an entity that stopped before its last move was synced settles there
+    while(carried < front.size() && front[carried].entity < n)
+      ++carried;
+    if(pos == last_pos && (carried == front.size() ||
+      front[carried].entity != n ||
+      !_transformPending(front[carried], synced_alpha)))
+    {
+      continue;
+    }
+
+    back.push_back(__Transform{_entities[n]->_scene_graph_node,
+      (int)_store.handle[n] - 1, n,
+      {(float)last_pos.x, (float)last_pos.y, (float)last_pos.z},
+      {(float)pos.x, (float)pos.y, (float)pos.z}});
+  }
+  _heights_stale = false;
+
+  std::lock_guard<std::mutex> lock(_transform_mutex);
+  _front_transforms = 1 - _front_transforms;
+  _synced_alpha = -1.;
 }
 
-void Entity::_pushApart(Entity* first, Entity* second)
+void Entity::_receivePath(void* owner, WorldGeo::PathHandle path)
 {
-  if((float)(second->_next_pos - first->_next_pos).magnitudeSquared() > .25)
-    return;
-
-  _vec2_t vec = (second->_next_pos - first->_next_pos).normalize() / 4;
-  _vec2_t center = (second->_next_pos + first->_next_pos) / 2;
-  second->_next_pos = center + vec;
-  first->_next_pos = center - vec;
+  Entity* entity = (Entity*)owner;
+  entity->_path_request = 0;
+  uint32_t index = entity->_index();
+  WorldGeo::freePath(_store.path[index]);
+  _store.path[index] = path;
+  _store.path_step[index] = 0;
 }
 
 //these constexprs should be replaced with entity specific members
@@ -94,150 +598,195 @@ constexpr int __l_range = 6;
 
 void Entity::_giveVision()
 {
+  const _vec3_t& pos = _position();
   _player_ptr->_vision_map->giveVision
-    ((int)_pos.x, (int)_pos.z, __s_range, __l_range);
+    ((int)pos.x, (int)pos.z, __s_range, __l_range);
 }
 
 void Entity::_takeVision()
 {
+  const _vec3_t& pos = _position();
   _player_ptr->_vision_map->takeVision
-    ((int)_pos.x, (int)_pos.z, __s_range, __l_range);
+    ((int)pos.x, (int)pos.z, __s_range, __l_range);
 }
 
 void Entity::_updateVision()
 {
+  const _vec3_t& pos = _position();
+  const _vec2_t& next_pos = _store.next_pos[_index()];
   _player_ptr->_vision_map->takeVision
-    ((int)_pos.x, (int)_pos.z, __s_range, __l_range);
+    ((int)pos.x, (int)pos.z, __s_range, __l_range);
   _player_ptr->_vision_map->giveVision
-    ((int)_next_pos.x, (int)_next_pos.y, __s_range, __l_range);
+    ((int)next_pos.x, (int)next_pos.y, __s_range, __l_range);
 }
 
 //public functions
+//the entity adds itself to the end of the store
 Entity::Entity(_ctype_t x, _ctype_t y, Player* player):
-_pos(x, _ctype_t(0), y), _target(x, y), _path_node(nullptr)
+_handle(_appendEntity(this, x, y)), _path_request(0), _scene_graph_node(0),
+_scene_graph_users(0)
 {
   _player_ptr = player;
   player->takeUnit(this);
   //player->_vision_map->giveVision((int)x, (int)y, 6);
 
-  _scene_graph_node = h3dAddModelNode(H3DRootNode, "", _cube_geo);
-  H3DNode mesh = h3dAddMeshNode(_scene_graph_node, "", _cube_mat, 0, 36, 0, 23);
-  h3dSetNodeTransform(
-    mesh,
-    0.0, .5, 0.0,
-    0.0, 0.0, 0.0,
-    1.0, 1.0, 1.0);
-  
   updatePosition();
 }
 
 Entity::~Entity()
 {
   //_player_ptr->_vision_map->takeVision((int)_pos.x, (int)_pos.z, 6);
-  h3dRemoveNode(_scene_graph_node);
+  //the store entries are dropped by the caller after deleting
+  uint32_t index = _index();
+  WorldGeo::cancelPathRequest(_path_request);
+  WorldGeo::releaseFlowField(_store.flow_field[index]);
+  WorldGeo::freePath(_store.path[index]);
+  //the transform buffers are cleared once the store is compacted
+  if(_scene_graph_node != 0)
+    h3dRemoveNode(_scene_graph_node);
+  _freeHandle(_handle);
 }
 
-void Entity::update()
+void Entity::_updateNode()
 {
-  _updateTarget();
-  Utils::Vec2_t<_ctype_t> direction =
-  _target - Utils::Vec2_t<_ctype_t>(_pos.x, _pos.z);
-  direction = direction.normalize() / 20;
-  //                                  ^
-  //that is a constant which controls movement speed(horrible magic numbers)
-  _next_pos.x = _pos.x + direction.x;
-  _next_pos.y = _pos.z + direction.y;
-
-  //updatePosition();
+  const _vec3_t& pos = _position();
+  float position[3] = {(float)pos.x, (float)pos.y, (float)pos.z};
+  float mat[16];
+  _translationMatrix(mat, position);
+  int instance = _handle - 1;
+  h3dSetInstanceTransMats(_unit_node, &instance, mat, 1);
+  if(_scene_graph_node != 0)
+    h3dSetNodeTransMats(&_scene_graph_node, mat, 1);
 }
 
-void Entity::finalize()
+void Entity::updatePosition()
 {
-  float x = (float)_next_pos.x;
-  float y = (float)_next_pos.y;
-  if(WorldGeo::isBlocked(x, y))
-  {
-    WorldGeo::pushIn(x, y, (float)_pos.x, (float)_pos.z);
-    _next_pos.x = x;
-    _next_pos.y = y;
-    
-    while(WorldGeo::isBlocked((float)_next_pos.x, (float)_next_pos.y))
-    {
-      _next_pos.x = _pos.x + (_next_pos.x - _pos.x) / 2;
-      _next_pos.y = _pos.z + (_next_pos.y - _pos.z) / 2;
-    }
-  }
-  
-  //update vision if entity changes tiles
-  if((int)_next_pos.x != (int)_pos.x ||
-    (int)_next_pos.y != (int)_pos.z)
-    _updateVision();
-  
-  _pos.x = _next_pos.x;
-  _pos.z = _next_pos.y;
-  
-  updatePosition();
+  _vec3_t& pos = _store.pos[_index()];
+  pos.y = (_ctype_t)Terrain::heightf((double)pos.x, (double)pos.z);
+  _updateNode();
 }
 
-void Entity::updatePosition()
+//getters
+Entities::EntityHandle Entity::getHandle() const
 {
-  _pos.y = (_ctype_t)Terrain::heightf((double)_pos.x, (double)_pos.z);
-  h3dSetNodeTransform(_scene_graph_node,
-                      (float)_pos.x, (float)_pos.y, (float)_pos.z,
-                      0.0, 0.0, 0.0,
-                      1., 1., 1.);
+  return _handle;
 }
 
-//getters
 void Entity::getPosition(float* x, float* y)
 {
-  *x = (float)_pos.x;
-  *y = (float)_pos.z;
+  const _vec3_t& pos = _position();
+  *x = (float)pos.x;
+  *y = (float)pos.z;
 }
 
 void Entity::getPosition(float* x, float* y, float * z)
 {
-  *x = (float)_pos.x;
-  *y = (float)_pos.y;
-  *z = (float)_pos.z;
+  const _vec3_t& pos = _position();
+  *x = (float)pos.x;
+  *y = (float)pos.y;
+  *z = (float)pos.z;
 }
 
 Utils::Vec3f Entity::getPosition()
 {
-  return Utils::Vec3f((float)_pos.x, (float)_pos.y, (float)_pos.z);
+  const _vec3_t& pos = _position();
+  return Utils::Vec3f((float)pos.x, (float)pos.y, (float)pos.z);
+}
+
+float Entity::getRadius() const
+{
+  return _store.radius[_index()];
 }
 
 void Entity::getPosition(int* x, int* y)
 {
-  *x = (int)_pos.x;
-  *y = (int)_pos.z;
+  const _vec3_t& pos = _position();
+  *x = (int)pos.x;
+  *y = (int)pos.z;
 }
 
 void Entity::getPosition(int* x, int* y, int* z)
 {
-  *x = (int)_pos.x;
-  *y = (int)_pos.y;
-  *z = (int)_pos.z;
+  const _vec3_t& pos = _position();
+  *x = (int)pos.x;
+  *y = (int)pos.y;
+  *z = (int)pos.z;
 }
 
 
-H3DNode Entity::getSceneGraphNode()
+H3DNode Entity::acquireSceneGraphNode()
 {
+  if(_scene_graph_users++ == 0)
+  {
+    const _vec3_t& pos = _position();
+    _scene_graph_node = h3dAddGroupNode(H3DRootNode, "");
+    h3dSetNodeTransform(_scene_graph_node,
+                        (float)pos.x, (float)pos.y, (float)pos.z,
+                        0., 0., 0., 1., 1., 1.);
+  }
   return _scene_graph_node;
 }
 
+void Entity::releaseSceneGraphNode()
+{
+  if(_scene_graph_users == 0 || --_scene_graph_users != 0)
+    return;
+  _forgetNode(_scene_graph_node);
+  h3dRemoveNode(_scene_graph_node);
+  _scene_graph_node = 0;
+}
+
 //setters
 void Entity::setTarget(float x, float y)
 {
-  _target.x = _ctype_t(x);
-  _target.y = _ctype_t(y);
+  _vec2_t& target = _store.target[_index()];
+  target.x = _ctype_t(x);
+  target.y = _ctype_t(y);
 }
 
 //command functions
 void Entity::issueMoveCommand(float x, float y)
 {
-  delete _path_node;
-  _path_node = WorldGeo::findPath((float)_pos.x, (float)_pos.z, x, y);
+  //the unit stops until the new path arrives
+  uint32_t index = _index();
+  WorldGeo::cancelPathRequest(_path_request);
+  WorldGeo::releaseFlowField(_store.flow_field[index]);
+  _store.flow_field[index] = 0;
+  WorldGeo::freePath(_store.path[index]);
+  _store.path[index] = 0;
+  const _vec3_t& pos = _store.pos[index];
+  _path_request = WorldGeo::requestPath((float)pos.x, (float)pos.z, x, y,
+                                        _store.radius[index], this);
+}
+
+//moves along an already computed path, which the entity takes over
+void Entity::issueMoveCommand(WorldGeo::PathHandle path)
+{
+  uint32_t index = _index();
+  WorldGeo::cancelPathRequest(_path_request);
+  _path_request = 0;
+  WorldGeo::releaseFlowField(_store.flow_field[index]);
+  _store.flow_field[index] = 0;
+  WorldGeo::freePath(_store.path[index]);
+  _store.path[index] = path;
+  _store.path_step[index] = 0;
+}
+
+//steers along the flow field shared by all units ordered to x, y, which
+//keeps radius clear of obstacles
+void Entity::issueFlowCommand(float x, float y, float radius)
+{
+  uint32_t index = _index();
+  WorldGeo::cancelPathRequest(_path_request);
+  _path_request = 0;
+  WorldGeo::freePath(_store.path[index]);
+  _store.path[index] = 0;
+  WorldGeo::FlowFieldId old_field = _store.flow_field[index];
+  const _vec3_t& pos = _store.pos[index];
+  _store.flow_field[index] =
+    WorldGeo::acquireFlowField((float)pos.x, (float)pos.z, x, y, radius);
+  //released after acquiring, so a repeated order keeps the cached field
+  WorldGeo::releaseFlowField(old_field);
 }
 
 //memory allocation overloads
@@ -262,7 +811,15 @@ namespace Entities
     Resources::generateCube(_cube_geo, 0.2);
 
     //find materials
-    _cube_mat = h3dFindResource(H3DResTypes::Material, "model.xml");
+    _cube_mat = h3dFindResource(H3DResTypes::Material, "unit.xml");
+
+    //the cube sits on the ground
+    _unit_node = h3dAddInstancedMeshNode(H3DRootNode, "units", _cube_geo,
+                                         _cube_mat, 0, 36, 0, 23);
+    h3dSetNodeTransform(_unit_node, 0., .5, 0., 0., 0., 0., 1., 1., 1.);
+    _unit_instances = 0;
+
+    _entity_workers.reset(new Utils::ThreadPool);
   }
 
   void deinit()
@@ -273,37 +830,151 @@ namespace Entities
       delete *it;
     }
     _entities.clear();
+    _store.resize(0);
+    _clearTransforms();
+    _entity_slots.clear();
+    _free_handles.clear();
+    _entity_count = 0;
+
+    h3dRemoveNode(_unit_node);
+    _unit_node = 0;
 
     _entity_allocator.deallocate();
+    _entity_workers.reset();
   }
 
   void update()
   {
-    for(auto ptr: _entities)
-      ptr->update();
+    WorldGeo::deliverPaths(__path_budget, Entity::_receivePath);
+
+    WorldGeo::updateFlowFields();
+    _releases.resize(_entities.size());
+    _next_heights.resize(_entities.size());
+
+    _forEachEntity([](uint32_t begin, uint32_t end)
+    {
+      _updateTargets(begin, end);
+      _stepEntities(begin, end);
+    });
+    _releaseFinished();
     
-    for(auto it1 = _entities.begin(); it1 != _entities.end(); ++it1)
+    float max_radius = 0.;
+    for(float radius: _store.radius)
+      max_radius = std::max(max_radius, radius);
+    int32_t cell_size = std::max(_ctype_t(max_radius * 2).num, 1);
+
+    _grid_cells.resize(_entities.size());
+    for(uint32_t n = 0; n < _entities.size(); ++n)
+    {
+      _grid_cells[n].x = _gridCoord(_store.next_pos[n].x, cell_size);
+      _grid_cells[n].y = _gridCoord(_store.next_pos[n].y, cell_size);
+      _grid_cells[n].entity = n;
+    }
+    _buildGrid();
+
+    //pairs are pushed in the order of the full pairwise loop, units pushed
+    //into range of each other by the earlier pushes wait for the next tick
+    for(uint32_t n = 0; n < _entities.size(); ++n)
     {
-      for(auto it2 = it1 + 1; it2 != _entities.end(); ++it2)
+      _listNeighbours(n);
+      for(uint32_t other: _grid_neighbours)
+        _pushApart(n, other);
+    }
+    
+    _forEachEntity([](uint32_t begin, uint32_t end)
+    {
+      _keepOnNavMesh(begin, end);
+      _sampleHeights(begin, end);
+    });
+    Entity::_finalizeAll();
+  }
+
+  void syncTransforms(float alpha)
+  {
+    std::lock_guard<std::mutex> lock(_transform_mutex);
+    //frames drawn between ticks at the same alpha have nothing to move
+    if(alpha == _synced_alpha)
+      return;
+    _synced_alpha = alpha;
+
+    const std::vector<__Transform>& front = _transforms[_front_transforms];
+    if(front.empty())
+      return;
+    _sync_instances.resize(front.size());
+    _sync_mats.resize(front.size() * 16);
+    _sync_nodes.clear();
+    _sync_node_mats.clear();
+    for(unsigned n = 0; n < front.size(); ++n)
+    {
+      const __Transform& transform = front[n];
+      float pos[3];
+      for(int i = 0; i < 3; ++i)
+        pos[i] = transform.from[i] + (transform.to[i] - transform.from[i]) * alpha;
+      float* mat = &_sync_mats[n * 16];
+      _translationMatrix(mat, pos);
+      _sync_instances[n] = transform.instance;
+      if(transform.node != 0)
       {
-        Entity::_pushApart(*it1, *it2);
+        _sync_nodes.push_back(transform.node);
+        _sync_node_mats.insert(_sync_node_mats.end(), mat, mat + 16);
       }
     }
-    
-    for(auto ptr: _entities)
-      ptr->finalize();
+    h3dSetInstanceTransMats(_unit_node, _sync_instances.data(),
+                            _sync_mats.data(), front.size());
+    //only the few entities with attachments have nodes to move
+    if(!_sync_nodes.empty())
+    {
+      h3dSetNodeTransMats(_sync_nodes.data(), _sync_node_mats.data(),
+                          _sync_nodes.size());
+    }
   }
 
   void insertEntity(float x, float y, Player* player)
   {
-    Entity* entity;
-
-    entity = new Entity(_ctype_t(x), _ctype_t(y), player);
-    _entities.push_back(entity);
+    //the entity adds itself to the store
+    new Entity(_ctype_t(x), _ctype_t(y), player);
 
     ++_entity_count;
   }
 
+  void invalidateHeights()
+  {
+    _heights_stale = true;
+  }
+
+  Entity* getEntity(EntityHandle handle)
+  {
+    if(handle == 0 || handle > _entity_slots.size())
+      return nullptr;
+    uint32_t index = _entity_slots[handle - 1];
+    if(index >= _entities.size() || _store.handle[index] != handle)
+      return nullptr;
+    return _entities[index];
+  }
+
+  uint64_t hashState()
+  {
+    //FNV-1a, a byte at a time
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](uint32_t value)
+    {
+      for(int n = 0; n < 4; ++n)
+      {
+        hash ^= (value >> (n * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+      }
+    };
+
+    mix(_entities.size());
+    for(const _vec3_t& pos: _store.pos)
+    {
+      mix(pos.x.num);
+      mix(pos.y.num);
+      mix(pos.z.num);
+    }
+    return hash;
+  }
+
   void updatePassive(float xsrs, float ysrs, float xdest, float ydest)
   {
     //this function is for updating positions when game is not running
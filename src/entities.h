@@ -19,6 +19,9 @@ namespace Entities
   using _ctype_t = Utils::fixed32m_t;
   using _vec2_t = Utils::Vec2_t<_ctype_t>;
   using _vec3_t = Utils::Vec3_t<_ctype_t>;
+
+  //stays the same while the entity exists, unlike its storage index
+  typedef uint32_t EntityHandle;
   
   void update();
 }
@@ -35,22 +38,24 @@ protected:
   
   friend class Player;
 
+  //the state updated every tick is kept in arrays in entities.cpp
+  Entities::EntityHandle _handle;
   Player* _player_ptr;
   Utils::IntrusiveNode _player_node;
-  
-  _vec3_t _pos;
-  _vec2_t _next_pos;
-  _vec2_t _target;
-  PathNode* _path_node;
-  H3DNode _scene_graph_node;
+  WorldGeo::PathRequestId _path_request;
+  H3DNode _scene_graph_node;            //0 while nothing is attached
+  unsigned _scene_graph_users;
 
-  void _updateTarget();
+  uint32_t _index() const;
+  const _vec3_t& _position() const;
   
   void _giveVision();
   void _takeVision();
   void _updateVision();
+  void _updateNode();
   
-  static void _pushApart(Entity*, Entity*);
+  static void _finalizeAll();
+  static void _receivePath(void*, WorldGeo::PathHandle);
   
   friend void Entities::update();
 
@@ -59,20 +64,26 @@ public:
   Entity(_ctype_t x, _ctype_t y, Player*);
   ~Entity();
 
-  void update();
-  void finalize();
   void updatePosition();
 
+  Entities::EntityHandle getHandle() const;
   void getPosition(float*, float*);
   void getPosition(float*, float*, float*);
   Utils::Vec3f getPosition();
   void getPosition(int*, int*);
   void getPosition(int*, int*, int*);
+  float getRadius() const;
 
-  H3DNode getSceneGraphNode();
+  //an empty node that follows the entity, for attaching markers. it is
+  //added by the first acquire and removed with its children by the last
+  //release. only called from the thread that renders, while no tick runs
+  H3DNode acquireSceneGraphNode();
+  void releaseSceneGraphNode();
 
   void setTarget(float, float);
   void issueMoveCommand(float, float);
+  void issueMoveCommand(WorldGeo::PathHandle);
+  void issueFlowCommand(float, float, float);
   
   void* operator new(size_t);
   void operator delete(void*);
@@ -83,9 +94,21 @@ namespace Entities
   void init();
   void deinit();
 
+  //moves the scene graph nodes to the positions of the last tick, alpha
+  //blends in from the positions of the tick before. may be called from
+  //another thread than update
+  void syncTransforms(float alpha);
+  //the next tick samples the terrain height under every entity, not only
+  //under the moving ones
+  void invalidateHeights();
+
   //void setActiveCamera(Camera*);
 
   void insertEntity(float, float, Player*);
+  //nullptr if no entity has the handle
+  Entity* getEntity(EntityHandle);
+  //hash of the fixed point positions of all entities, in storage order
+  uint64_t hashState();
 
   void updatePassive(float, float, float, float);
   Entity* rayPickEntity(Camera*, float, float);
@@ -47,6 +47,7 @@ namespace
   struct alignas(8) TileVision
   {
     int16_t tx, ty;
+    bool lighted;           //which of the tile's two entries it is
     TileVisionBitset bits;
     
     bool isBlocked(int x, int y)
@@ -433,9 +434,10 @@ namespace
     
     //set _tile_vision_map element
     if(tv->tx != -1)
-      _tile_vision_map(tv->tx, tv->ty) = nullptr;
+      _tile_vision_map(tv->tx, tv->ty, tv->lighted) = nullptr;
     tv->tx = x;
     tv->ty = y;
+    tv->lighted = false;
     _tile_vision_map(x, y) = tv;
     ++_tile_vision_pool_idx;
     if(_tile_vision_pool_idx * sizeof(decltype(*_tile_vision_pool))
@@ -468,9 +470,10 @@ namespace
     
     //set _tile_vision_map_element
     if(tv->tx != -1)
-      _tile_vision_map(tv->ty, tv->ty, true) = nullptr;
+      _tile_vision_map(tv->tx, tv->ty, tv->lighted) = nullptr;
     tv->tx = x;
     tv->ty = y;
+    tv->lighted = true;
     _tile_vision_map(x, y, true) = tv;
     ++_tile_vision_pool_idx;
     if(_tile_vision_pool_idx * sizeof(decltype(*_tile_vision_pool))
@@ -803,7 +806,8 @@ void LosMap::giveVision(int x, int y, int range, int l_range)
   auto& tv_ptr = _tile_vision_map(x, y);
   auto& l_tv_ptr = _tile_vision_map(x, y, true);
   
-  if(tv_ptr == nullptr)
+  //either entry may have been recycled by the pool
+  if(tv_ptr == nullptr || l_tv_ptr == nullptr)
     _buildTileVision(x, y);
   
   if((void*)tv_ptr != (void*)1)
@@ -837,7 +841,8 @@ void LosMap::takeVision(int x, int y, int range, int l_range)
   auto& tv_ptr = _tile_vision_map(x, y);
   auto& l_tv_ptr = _tile_vision_map(x, y, true);
   
-  if(tv_ptr == nullptr)
+  //either entry may have been recycled by the pool
+  if(tv_ptr == nullptr || l_tv_ptr == nullptr)
     _buildTileVision(x, y);
   
   if((void*)tv_ptr != (void*)1)
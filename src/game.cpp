@@ -3,12 +3,18 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
 #include "interface.h"
 #include "scenario.h"
 #include "editor.h"
 #include "gui.h"
 #include "entities.h"
 #include "app.h"
+#include "commands.h"
 
 #include "game.h"
 
@@ -16,6 +22,81 @@ namespace
 {
   bool _running;
 
+  /*
+    the simulation ticks at a fixed rate on its own thread, the render
+    loop draws as often as it can keep up and blends the entities between
+    the last two ticks. everything both sides touch, input handling and
+    the interface included, is done under _sim_mutex. the scene graph is
+    only touched on the render thread.
+  */
+  using Clock = std::chrono::steady_clock;
+
+  constexpr int __tick_rate = 60;
+  constexpr Clock::duration __tick_length =
+    std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / __tick_rate;
+  //ticks run back to back before the rest of the backlog is dropped
+  constexpr unsigned __max_catch_up = 4;
+  //frames the render loop goes without input while a tick holds the lock
+  constexpr unsigned __max_skipped_frames = 4;
+
+  std::thread _sim_thread;
+  std::atomic<bool> _simulating(false);
+  std::mutex _sim_mutex;
+  std::atomic<Clock::rep> _last_tick(0);
+
+  Game::Timings _timings;
+  double _tick_total, _frame_total;
+
+  inline float _ms(Clock::duration duration)
+  {
+    return std::chrono::duration<float, std::milli>(duration).count();
+  }
+
+  void _simulate()
+  {
+    Clock::time_point next = Clock::now();
+
+    while(_simulating)
+    {
+      unsigned ticks = 0;
+      while(Clock::now() >= next && ticks < __max_catch_up)
+      {
+        Clock::time_point begin = Clock::now();
+        {
+          std::lock_guard<std::mutex> lock(_sim_mutex);
+          Scenario::tick();
+          _last_tick = Clock::now().time_since_epoch().count();
+        }
+        float time = _ms(Clock::now() - begin);
+        _tick_total += time;
+        _timings.tick_max = std::max(_timings.tick_max, time);
+        ++_timings.ticks;
+        next += __tick_length;
+        ++ticks;
+      }
+
+      //too far behind, carry on from now instead of spiralling
+      Clock::time_point now = Clock::now();
+      if(now >= next)
+      {
+        unsigned dropped = (now - next) / __tick_length + 1;
+        _timings.dropped_ticks += dropped;
+        next += __tick_length * dropped;
+      }
+
+      std::this_thread::sleep_until(next);
+    }
+  }
+
+  //how far the render loop is between the last tick and the next one
+  inline float _tickAlpha()
+  {
+    Clock::duration since =
+      Clock::now().time_since_epoch() - Clock::duration(_last_tick.load());
+    float alpha = (float)since.count() / __tick_length.count();
+    return std::min(std::max(alpha, 0.f), 1.f);
+  }
+
   inline void _processMessages()
   {
     /**
@@ -84,44 +165,91 @@ namespace Game
     const uint8_t* keystate;
     keystate = SDL_GetKeyboardState(nullptr);
 
-    Scenario::start();
+    Commands::startMatch();
+
+    _timings = Timings{};
+    _tick_total = _frame_total = 0.;
+    _last_tick = Clock::now().time_since_epoch().count();
+    _simulating = true;
+    _sim_thread = std::thread(_simulate);
     
     unsigned frame_count = 0;
+    unsigned skipped_frames = 0;
     AppCtrl::startFrameCount();
+    Clock::time_point last_frame = Clock::now();
     
     do
     {
+      Clock::time_point frame_begin = Clock::now();
+      float elapsed = std::chrono::duration<float>(frame_begin - last_frame).count();
+      last_frame = frame_begin;
+
+      //do sum SDL stuff
+      SDL_PumpEvents();
+
+      //a running tick only holds up input for a few frames
+      std::unique_lock<std::mutex> lock(_sim_mutex, std::defer_lock);
+      if(skipped_frames < __max_skipped_frames)
+      {
+        if(!lock.try_lock())
+          ++skipped_frames;
+      }
+      else lock.lock();
+
+      if(lock.owns_lock())
+      {
+        skipped_frames = 0;
+        _processMessages();
+        Interface::update();
+        Scenario::present();
+        lock.unlock();
+      }
+
+      //the camera moved .05 a tick when it was moved with the simulation
+      float camera_step = .05 * __tick_rate * elapsed;
+      if(keystate[SDL_SCANCODE_S])
+        Scenario::moveCamera(-camera_step, -camera_step);
+      if(keystate[SDL_SCANCODE_W])
+        Scenario::moveCamera(camera_step, camera_step);
+      if(keystate[SDL_SCANCODE_A])
+        Scenario::moveCamera(camera_step, -camera_step);
+      if(keystate[SDL_SCANCODE_D])
+        Scenario::moveCamera(-camera_step, camera_step);
+
       //render stuff
+      Entities::syncTransforms(_tickAlpha());
       h3dRender(Scenario::camera->handle);
       h3dFinalizeFrame();
       SDL_GL_SwapWindow(AppCtrl::screen);
-      
-      while(frame_count <= AppCtrl::getFrameCount())
-      {
-        //do sum SDL stuff
-        SDL_PumpEvents();
-        _processMessages();
 
-        if(keystate[SDL_SCANCODE_S])
-          Scenario::moveCamera(-0.05, -0.05);
-        if(keystate[SDL_SCANCODE_W])
-          Scenario::moveCamera(0.05, 0.05);
-        if(keystate[SDL_SCANCODE_A])
-          Scenario::moveCamera(0.05, -0.05);
-        if(keystate[SDL_SCANCODE_D])
-          Scenario::moveCamera(-0.05, 0.05);
-        
-        Interface::update();
-        Scenario::proceed();
-        ++frame_count;
-      }
-      
-      AppCtrl::delayToFrame(frame_count);
-      
       AppCtrl::dumpMessages();
       AppCtrl::collectStats();
+
+      float time = _ms(Clock::now() - frame_begin);
+      _frame_total += time;
+      _timings.frame_max = std::max(_timings.frame_max, time);
+      ++_timings.frames;
+
+      //no faster than the tick rate, a slow frame does not make up for it
+      frame_count = AppCtrl::getFrameCount(__tick_rate) + 1;
+      AppCtrl::delayToFrame(frame_count, __tick_rate);
     }while(_running);
 
-    Scenario::end();
+    _simulating = false;
+    _sim_thread.join();
+
+    Commands::endMatch();
+    //the editing and the match, for replaying as a benchmark
+    Commands::saveLog((AppCtrl::app_path + "last_match.replay").c_str());
+  }
+
+  void getTimings(Timings* timings)
+  {
+    //only read while no game is played
+    *timings = _timings;
+    if(_timings.ticks)
+      timings->tick_avg = _tick_total / _timings.ticks;
+    if(_timings.frames)
+      timings->frame_avg = _frame_total / _timings.frames;
   }
 }
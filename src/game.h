@@ -3,7 +3,16 @@
 
 namespace Game
 {
+  //milliseconds, kept over the last play
+  struct Timings
+  {
+    unsigned ticks, dropped_ticks, frames;
+    float tick_avg, tick_max;
+    float frame_avg, frame_max;
+  };
+
   void play();
+  void getTimings(Timings*);
 }
 
 #endif // GAME_H_INCLUDED
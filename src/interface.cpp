@@ -13,6 +13,7 @@
 #include "entities.h"
 #include "scenario.h"
 #include "resources.h"
+#include "commands.h"
 
 #include "interface.h"
 
@@ -51,7 +52,7 @@ namespace
     {
       entity = sel.entity;
       node = h3dAddModelNode(
-        entity->getSceneGraphNode(),
+        entity->acquireSceneGraphNode(),
         "", _mesh_fac.res);
       h3dSetNodeTransform(
         node,
@@ -67,11 +68,16 @@ namespace
     }
     ~Selection()
     {
-      if(node) h3dRemoveNode(node);
+      if(node)
+      {
+        h3dRemoveNode(node);
+        entity->releaseSceneGraphNode();
+      }
     }
   };
 
   std::vector<Selection> _selection;
+  std::vector<Entity*> _ordered_units;
 
   //entity stuff
   struct UnitBox
@@ -413,10 +419,11 @@ namespace Interface
       _calculateClickPosition(x, y);
 
       //dispatch order
+      _ordered_units.clear();
       for(auto& x: _selection)
-      {
-        x.entity->issueMoveCommand(_cursor.x_map_point, _cursor.y_map_point);
-      }
+        _ordered_units.push_back(x.entity);
+      Commands::moveUnits(_ordered_units,
+                          _cursor.x_map_point, _cursor.y_map_point);
     }
 
     void rightRelease()
@@ -471,25 +478,25 @@ namespace Interface
     inline void _draw()
     {
       if((_cursor.mode & 0xff00) == mode_brush)
-        Terrain::modifyDistanceFieldMap(
+        Commands::paintTerrain(
           _cursor.x_tile, _cursor.y_tile,
-          _cursor.size, _cursor.size,
+          _cursor.size,
           _cursor.state & _cursor.low_nibble);
       else if((_cursor.mode & 0xff00) == mode_slope)
       {
         switch(_cursor.mode)
         {
           case mode_slope_ne:
-          Terrain::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_northeast);
+          Commands::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_northeast);
           break;
           case mode_slope_se:
-          Terrain::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_southeast);
+          Commands::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_southeast);
           break;
           case mode_slope_sw:
-          Terrain::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_southwest);
+          Commands::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_southwest);
           break;
           case mode_slope_nw:
-          Terrain::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_northwest);
+          Commands::addSlope(_cursor.x_tile, _cursor.y_tile, Terrain::cliff_northwest);
           break;
         }
       }
@@ -499,13 +506,13 @@ namespace Interface
         {
           auto p_ptr = Scenario::getPlayer(1);
       
-          Entities::insertEntity(_cursor.x_map_pos, _cursor.y_map_pos, p_ptr);
+          Commands::spawnUnit(_cursor.x_map_pos, _cursor.y_map_pos, p_ptr);
           _cursor.state = 0;
         }
       }
       else if(_cursor.mode == mode_light)
       {
-        FogOfWar::insertLightSource(_cursor.x_map_pos, _cursor.y_map_pos, 6.0);
+        Commands::placeLight(_cursor.x_map_pos, _cursor.y_map_pos, 6.0);
         _cursor.state = 0;
       }
       else return;
@@ -70,8 +70,8 @@ void Player::updateVision()
   _vsdfl_map->clearDistances();
   for(auto unit: _units)
   {
-    auto x = unit->_pos.x - .5;
-    auto z = unit->_pos.z - .5;
+    auto x = unit->_position().x - .5;
+    auto z = unit->_position().z - .5;
     _vsdf_map->insertPoint(x, z, 2.75);
     _vsdfl_map->insertPoint(x, z, 6.75);
   }
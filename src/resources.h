@@ -32,6 +32,7 @@ namespace
     "h_map_overlay_2.xml",
     "unit_hilite.xml",
     "model.xml",
+    "unit.xml",
     "dragbox.xml",
     "navmesh.xml",
     "deferred.xml",
@@ -8,6 +8,7 @@
 #include "terrain.h"
 #include "entities.h"
 #include "fow.h"
+#include "commands.h"
 
 #include "scenario.h"
 
@@ -256,6 +257,7 @@ namespace Scenario
   {
     map_width = x;
     map_height = y;
+    Commands::beginLog(x, y);
   
     Terrain::create(x, y);
     Terrain::addWater();
@@ -328,20 +330,36 @@ namespace Scenario
     //WorldGeo::removeNavMesh();
   }
 
-  void proceed()
+  void tick()
   {
-    //update water animation
     ++_time_lapsed;
+    Entities::update();
+    Commands::recordTick();
+  }
+
+  void present()
+  {
+    //update water animation
     h3dSetMaterialUniform(_water_mat_res, "wavePos",
                     ((float)(_time_lapsed % 400)) / 400.0, 0.0, 0.0, 0.0);
 
-    Entities::update();
-    
     if(_active)
     {
       FogOfWar::update();
     }
   }
+
+  void proceed()
+  {
+    tick();
+    Entities::syncTransforms(1.);
+    present();
+  }
+
+  uint32_t ticksLapsed()
+  {
+    return _time_lapsed;
+  }
   
   //player functions
   Player* newPlayer()
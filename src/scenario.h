@@ -65,7 +65,12 @@ namespace Scenario
   void destroy();
   void start();
   void end();
+  //tick advances the simulation and touches no scene graph state, present
+  //brings the scene up to date with it. proceed does both
+  void tick();
+  void present();
   void proceed();
+  uint32_t ticksLapsed();
   
   Player* newPlayer();
   Player* newPlayer(const char*);
@@ -670,6 +670,7 @@ namespace Terrain
       _large_map[n] = 0;
 
     _blocked_map.set();
+    WorldGeo::invalidateNavMesh();
 
     //material setup
     h3dSetMaterialUniform(_general_mat_res, "hmap_size",
@@ -1127,6 +1128,7 @@ namespace Terrain
     }
 
     _cleanBlockedMap(xsrs, ysrs, xdest, ydest);
+    WorldGeo::invalidateNavMesh(xsrs, ysrs, xdest, ydest);
 
     //normals
     ++xsrs; ++ysrs; --xdest; --ydest;
@@ -1165,7 +1167,14 @@ namespace Terrain
     Resources::writeBWBitmap(_width * 4, _length * 4, buffer);
     delete[] buffer;*/
 
-    WorldGeo::setupNavMesh(_width * 8, _length * 8, &_blocked_map);
+    //unchanged maps skip triangulation
+    std::string cache_path = AppCtrl::app_path + "navmesh.cache";
+    if(!WorldGeo::loadNavMesh(cache_path.c_str(), _width * 8, _length * 8,
+                              &_blocked_map))
+    {
+      WorldGeo::setupNavMesh(_width * 8, _length * 8, &_blocked_map);
+      WorldGeo::saveNavMesh(cache_path.c_str());
+    }
   }
 
   void deinitWorldGeo()
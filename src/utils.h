@@ -9,6 +9,14 @@
 #include <cstdio>
 
 #include <utility>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
 
 #include "mathutils.h"
 
@@ -1091,6 +1099,14 @@ class QuadTree
 
         this->divide();
 
+        //a node at MaxLevel turns into bulk storage instead of dividing
+        if(status & maxout)
+        {
+          --entries;
+          this->insert(st);
+          return;
+        }
+
         float x_center = (left + right) / 2;
         float y_center = (top + bottom) / 2;
 
@@ -1777,169 +1793,280 @@ public:
 **      CACHE FRIENDLY HEAP      **
 **********************************/
 
-template<class T>
+/*
+  min heap of the items 0 to n - 1 ordered by key. every node has four
+  children, so the children compared while sifting down share a cache
+  line and the heap is half as deep as a binary one. the node of every
+  queued item is indexed, a queued item has its key lowered in place
+  instead of being pushed again. clearing keeps the storage, a heap
+  reused across searches stops allocating after the largest one.
+*/
+template<class K>
 class CFHeap
 {
-  T* storage;
-  int capacity;
-  int _size;
-  
-  void allocate_more()
+  struct __Node
   {
-    capacity <<= 1;
-    capacity += 1;
-    T* temp = static_cast<T*>(::operator new(capacity * sizeof(T)));
-    for(int i = 0; i < _size; ++i)
-    {
-      new(temp + i) T(std::move(storage[i]));
-    }
-    delete[] storage;
-    storage = temp;
+    K key;
+    int item;
+  };
+
+  std::vector<__Node> _nodes;
+  std::vector<int> _index;      //node of every item, -1 if not queued
+
+  void _place(int pos, const __Node& node)
+  {
+    _nodes[pos] = node;
+    _index[node.item] = pos;
   }
-  void up_swap()
+
+  void _siftUp(int pos)
   {
-    int idx = _size;
-    while(idx != 0)
+    __Node node = _nodes[pos];
+    while(pos != 0)
     {
-      int next_idx = ((idx + 1) >> 1) - 1;
-      if(storage[idx] > storage[next_idx])
-      {
-        std::swap(storage[idx], storage[next_idx]);
-        idx = next_idx;
-      }
-      else break;
+      int parent = (pos - 1) >> 2;
+      if(!(node.key < _nodes[parent].key))
+        break;
+      _place(pos, _nodes[parent]);
+      pos = parent;
     }
+    _place(pos, node);
   }
-  void down_swap()
+
+  void _siftDown(int pos)
   {
-    int idx = 0;
-    do
+    __Node node = _nodes[pos];
+    int size = _nodes.size();
+    for(;;)
     {
-      int next_idx = ((idx + 1) << 1) - 1;
-      if(next_idx >= _size) break;
-      if(next_idx + 1 != _size && storage[next_idx] < storage[next_idx + 1])
-        ++next_idx;
-      if(storage[idx] < storage[next_idx])
+      int child = (pos << 2) + 1;
+      if(child >= size)
+        break;
+      int end = child + 4 < size? child + 4 : size;
+      int least = child;
+      for(int c = child + 1; c < end; ++c)
       {
-        std::swap(storage[idx], storage[next_idx]);
-        idx = next_idx;
+        if(_nodes[c].key < _nodes[least].key)
+          least = c;
       }
-      else break;
-    }while(true);
+      if(!(_nodes[least].key < node.key))
+        break;
+      _place(pos, _nodes[least]);
+      pos = least;
+    }
+    _place(pos, node);
   }
-  
+
 public:
-  CFHeap()
+
+  //makes room for the items 0 to items - 1 up front
+  void reserve(unsigned items)
   {
-    storage = static_cast<T*>(::operator new(15 * sizeof(T)));
-    capacity = 15;
-    _size = 0;
+    if(items > _index.size())
+      _index.resize(items, -1);
+    _nodes.reserve(items);
   }
-  CFHeap(const CFHeap<T>& other)
+
+  bool empty() const
   {
-    capacity = other.capacity;
-    _size = other._size;
-    storage = static_cast<T*>(::operator new(capacity * sizeof(T)));
-    for(int i = 0; i < _size; ++i)
-      new(storage + i) T(other.storage[i]);
+    return _nodes.empty();
   }
-  CFHeap(CFHeap<T>&& other)
+  unsigned size() const
   {
-    capacity = other.capacity;
-    _size = other.size;
-    storage = other.storage;
-    other.storage = nullptr;
-    other._size = 0;
+    return _nodes.size();
   }
-  ~CFHeap()
+  bool contains(int item) const
   {
-    for(int i = 0; i < _size; ++i)
-      storage[i].~T();
-    ::operator delete(storage);
+    return (unsigned)item < _index.size() && _index[item] != -1;
   }
-  
-  CFHeap<T>& operator=(const CFHeap<T>& other)
-  {
-    for(int i = 0; i < _size; ++i)
-      storage[i].~T();
-    ::operator delete(storage);
-    capacity = other.capacity;
-    _size = other._size;
-    storage = static_cast<T*>(::operator new(capacity * sizeof(T)));
-    for(int i = 0; i < _size; ++i)
-      new(storage + i) T(other.storage[i]);
-    return *this;
+
+  //the item with the least key and its key
+  int top() const
+  {
+    return _nodes[0].item;
   }
-  CFHeap<T>& operator=(CFHeap<T>&& other)
+  K topKey() const
   {
-    for(int i = 0; i < _size; ++i)
-      storage[i].~T();
-    ::operator delete(storage);
-    capacity = other.capacity;
-    _size = other._size;
-    storage = other.storage;
-    other.storage = nullptr;
-    other._size = 0;
+    return _nodes[0].key;
   }
-  
-  void push(const T& element)
+
+  //item must not be queued
+  void push(int item, K key)
   {
-    if(_size == capacity)
-      allocate_more();
-    new(storage + _size) T(element);
-    up_swap();
-    ++_size;
+    if((unsigned)item >= _index.size())
+      _index.resize(item + 1, -1);
+    assert(_index[item] == -1);
+    _nodes.push_back({key, item});
+    _siftUp(_nodes.size() - 1);
   }
-  void push(T&& element)
+
+  //item must be queued with a key not less than key
+  void decrease(int item, K key)
   {
-    if(_size == capacity)
-      allocate_more();
-    new(storage + _size) T(element);
-    up_swap();
-    ++size;
+    int pos = _index[item];
+    assert(!(_nodes[pos].key < key));
+    _nodes[pos].key = key;
+    _siftUp(pos);
   }
+
+  //queues item, or lowers its key if it is queued with a greater one.
+  //returns false if the heap is unchanged
+  bool update(int item, K key)
+  {
+    if(!contains(item))
+    {
+      push(item, key);
+      return true;
+    }
+    if(!(key < _nodes[_index[item]].key))
+      return false;
+    decrease(item, key);
+    return true;
+  }
+
   void pop()
   {
-    storage->~T();
-    new(storage) T(std::move(storage[_size - 1]));
-    storage[_size - 1].~T();
-    --_size;
-    down_swap();
+    _index[_nodes[0].item] = -1;
+    __Node last = _nodes.back();
+    _nodes.pop_back();
+    if(!_nodes.empty())
+    {
+      _nodes[0] = last;
+      _siftDown(0);
+    }
+  }
+
+  //only walks the queued items
+  void clear()
+  {
+    for(auto& node: _nodes)
+      _index[node.item] = -1;
+    _nodes.clear();
   }
-  template<class... Args>
-  void emplace(Args&&... args)
+};
+
+
+/**********************************
+**          THREAD POOL          **
+**********************************/
+
+//jobs receive the index of the worker running them, so callers can keep
+//per-worker scratch data without locking
+class ThreadPool
+{
+  std::vector<std::thread> _threads;
+  std::deque<std::function<void(unsigned)>> _jobs;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  bool _quit;
+
+  void _work(unsigned worker)
   {
-    if(_size == capacity)
-      allocate_more();
-    new(storage) T(std::forward<Args>(args)...);
-    up_swap();
-    ++_size;
+    for(;;)
+    {
+      std::function<void(unsigned)> job;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cond.wait(lock, [this]{return _quit || !_jobs.empty();});
+        if(_jobs.empty())
+          return;
+        job = std::move(_jobs.front());
+        _jobs.pop_front();
+      }
+      job(worker);
+    }
+  }
+
+public:
+
+  ThreadPool(unsigned threads = 0): _quit(false)
+  {
+    if(threads == 0)
+    {
+      threads = std::thread::hardware_concurrency();
+      threads = threads > 1? threads - 1 : 1;
+    }
+    for(unsigned n = 0; n < threads; ++n)
+      _threads.emplace_back(&ThreadPool::_work, this, n);
   }
-  void swap(CFHeap<T>& other)
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ~ThreadPool()
   {
-    int cap = capacity;
-    int si = _size;
-    auto st = storage;
-    capacity = other.capacity;
-    _size = other._size;
-    storage = other.storage;
-    other.capacity = cap;
-    other._size = si;
-    other.storage = st;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _quit = true;
+    }
+    _cond.notify_all();
+    for(auto& thread: _threads)
+      thread.join();
   }
 
-  T& top()
+  unsigned size() const
   {
-    return *storage;
+    return _threads.size();
   }
-  
-  bool empty()
+
+  void submit(std::function<void(unsigned)> job)
   {
-    return _size == 0;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _jobs.push_back(std::move(job));
+    }
+    _cond.notify_one();
   }
-  int size()
+
+  /*
+    calls job(begin, end) for consecutive ranges of at most chunk indices
+    covering 0 to count, and returns once all ranges are done. the calling
+    thread takes ranges too, so a single range never leaves it. which
+    thread runs a range is not fixed, jobs only writing the indices of
+    their range give the same results as a sequential loop.
+  */
+  void parallelFor(unsigned count, unsigned chunk,
+                   const std::function<void(unsigned, unsigned)>& job)
   {
-    return _size;
+    unsigned ranges = (count + chunk - 1) / chunk;
+    if(ranges <= 1)
+    {
+      if(count != 0)
+        job(0, count);
+      return;
+    }
+
+    struct
+    {
+      std::atomic<unsigned> next;
+      unsigned helpers;
+      std::mutex mutex;
+      std::condition_variable done;
+    } state;
+    unsigned helpers = std::min<unsigned>(ranges - 1, _threads.size());
+    state.next = 0;
+    state.helpers = helpers;
+
+    auto run = [&state, &job, count, chunk]()
+    {
+      unsigned begin;
+      while((begin = state.next.fetch_add(chunk)) < count)
+        job(begin, std::min(begin + chunk, count));
+    };
+
+    for(unsigned n = 0; n < helpers; ++n)
+    {
+      submit([&state, &run](unsigned)
+      {
+        run();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if(--state.helpers == 0)
+          state.done.notify_one();
+      });
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.done.wait(lock, [&state]{return state.helpers == 0;});
   }
 };
 
@@ -8,15 +8,31 @@
 #include <ctime>
 #include <csignal>
 
-#include <queue>
 #include <bitset>
 #include <utility>
 #include <vector>
 #include <algorithm>
+#include <limits>
 #include <initializer_list>
 #include <list>
 #include <complex>
 #include <memory>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <type_traits>
+#include <queue>
+#ifdef WORLD_GEO_BENCH
+#include <chrono>
+#include <random>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "utils.h"
 
@@ -94,12 +110,18 @@ namespace
     int indices[3];
     int cons[3];
     short dists[3];
+    /*
+      widest unit that fits between two connections, in the order of dists:
+      clearance[0] between cons[0] and cons[1] and so on
+    */
+    float clearance[3];
     float center_x, center_y;
 
     __NavMeshTriangle()
     {
       for(auto& i: indices)   i = 0;
       for(auto& c: cons)      c = -1;
+      for(auto& c: clearance) c = 0.f;
     }
     __NavMeshTriangle(int a, int b, int c)
     {
@@ -107,6 +129,7 @@ namespace
       indices[1] = b;
       indices[2] = c;
       for(auto& c: cons) c = -1;
+      for(auto& c: clearance) c = 0.f;
     }
 
     void addToIndices(int n)
@@ -180,6 +203,26 @@ namespace
       return -1;
     }
 
+    //clearance of passing between the connections with indices a and b
+    float crossing(int a, int b) const
+    {
+      return clearance[(a + 1) % 3 == b? a : b];
+    }
+
+    /*
+      triangles of carved tiles are left in place for stale references
+      until the navmesh is compacted. a negative clearance marks them, which
+      also fails every width test.
+    */
+    void kill()
+    {
+      for(auto& c: clearance) c = -1.f;
+    }
+    bool dead() const
+    {
+      return clearance[0] < 0.f;
+    }
+
     friend bool hasMutualSide(const __NavMeshTriangle& a,
                               const __NavMeshTriangle& b)
     {
@@ -238,19 +281,21 @@ namespace
   
   inline int _getPlate(int tri)
   {
-    int approx = (tri * _num_plates) / _navmesh_triangles.size();
-    
-    if(tri < _plate_ofsets[approx])
-      do --approx; while(tri < _plate_ofsets[approx]);
-    else if(tri >= _plate_ofsets[approx + 1])
-      do; while(tri >= _plate_ofsets[++approx + 1]);
-  
-    return approx;
+    return std::upper_bound(_plate_ofsets, _plate_ofsets + _num_plates + 1, tri)
+          - _plate_ofsets - 1;
+  }
+
+  //plates linked across tile borders share a component
+  std::vector<int>                  _plate_components;
+
+  inline int _getComponent(int tri)
+  {
+    return _plate_components[_getPlate(tri)];
   }
 
   //__NavMeshTriangle* _navmesh_triangles = nullptr;
 
-  ///NavMeshTriangle QuadTree
+  ///NavMeshTriangle tests
 
   inline bool _isInside(NavMeshVert p1, NavMeshVert p2,
                         NavMeshVert p3, NavMeshVert point)
@@ -338,25 +383,349 @@ namespace
     return true;
   }
 
-  Utils::ArenaAllocator
-  <Utils::QuadTreeDummy<int, 8>::node_size, 64> _nmtqt_allocator;
+  uint16_t _mapsize_w;
+  uint16_t _mapsize_h;
+
+  ///navmesh triangle locator
+  /*
+    uniform grid with one bucket per world unit. the buckets are ranges of
+    one entry array, and every entry carries its triangle's vertices in
+    counter clockwise order, so locating a point reads one bucket and
+    nothing else. carving rewrites the buckets it touches at the end of the
+    array, the old entries stay unused until the navmesh is compacted.
+  */
+  struct __LocatorEntry
+  {
+    float x[3], y[3];
+    int triangle;
+  };
+
+  struct __BucketRange
+  {
+    unsigned begin, end;
+  };
+
+  std::vector<__LocatorEntry> _locator_entries;
+  std::vector<__BucketRange> _locator_buckets;
+  int _locator_w = 0;
+  int _locator_h = 0;
 
-  //global functions for allocating shit
-  void* _nmtqt_allocate(size_t s)
+  inline bool _locatorContains(const __LocatorEntry& e, float x, float y)
   {
-    return _nmtqt_allocator.getAdress();
+    float d0 = (e.x[1] - e.x[0]) * (y - e.y[0]) - (e.y[1] - e.y[0]) * (x - e.x[0]);
+    float d1 = (e.x[2] - e.x[1]) * (y - e.y[1]) - (e.y[2] - e.y[1]) * (x - e.x[1]);
+    float d2 = (e.x[0] - e.x[2]) * (y - e.y[2]) - (e.y[0] - e.y[2]) * (x - e.x[2]);
+    //no early outs, buckets are short and this keeps the loop branch free
+    return (d0 >= 0.f) & (d1 >= 0.f) & (d2 >= 0.f);
   }
-  void _nmtqt_deallocate(void* p)
+
+  //triangle containing x, y or -1
+  int _locateTriangle(float x, float y)
   {
-    _nmtqt_allocator.freeAdress(p);
+    //also rejects nan
+    if(!(x >= 0.f && y >= 0.f))
+      return -1;
+    int bucket_x = x;
+    int bucket_y = y;
+    if(bucket_x >= _locator_w || bucket_y >= _locator_h)
+      return -1;
+
+    const __BucketRange& bucket = _locator_buckets[bucket_x + bucket_y * _locator_w];
+    for(unsigned n = bucket.begin; n < bucket.end; ++n)
+    {
+      if(_locatorContains(_locator_entries[n], x, y))
+        return _locator_entries[n].triangle;
+    }
+    return -1;
   }
 
-  Utils::QuadTree<int, 8, -1, 8, _intersects, _contains,
-  _nmtqt_allocate, _nmtqt_deallocate> _nav_mesh_triangle_tree;
-  bool _nav_mesh_triangle_tree_inited = false;
+  //walks from triangle hint towards x, y across shared edges, the grid is
+  //only used without a usable hint or when the walk leaves the mesh
+  int _walkToTriangle(int hint, float x, float y)
+  {
+    //entities move a fraction of a triangle per tick, long walks mean the
+    //hint is stale
+    constexpr int max_steps = 8;
 
-  uint16_t _mapsize_w;
-  uint16_t _mapsize_h;
+    if(hint < 0 || hint >= (int)_navmesh_triangles.size()
+      || _navmesh_triangles[hint].dead())
+      return _locateTriangle(x, y);
+
+    NavMeshVert point(x, y);
+    for(int step = 0; step < max_steps; ++step)
+    {
+      __NavMeshTriangle& tri = _navmesh_triangles[hint];
+      NavMeshVert v[3] = {_navmesh_verts[tri.indices[0]],
+                          _navmesh_verts[tri.indices[1]],
+                          _navmesh_verts[tri.indices[2]]};
+      double d = _dotProduct(_turn90d(v[1] - v[0]), v[2] - v[0]);
+
+      int exit = -1;
+      for(int k = 0; k < 3; ++k)
+      {
+        if(d * _dotProduct(_turn90d(v[(k + 1) % 3] - v[k]), point - v[k]) < 0.)
+        {
+          exit = k;
+          break;
+        }
+      }
+      if(exit == -1)
+        return hint;
+      if(tri.cons[exit] == -1)
+        break;
+      hint = tri.cons[exit];
+    }
+
+    return _locateTriangle(x, y);
+  }
+
+  /*
+    sorts (bucket, item) pairs of the buckets x0 <= x < x1, y0 <= y < y1
+    into new ranges at the end of entries. the pairs come in triangle order
+    and keep it within a bucket.
+  */
+  template<class T>
+  void _fillBuckets(std::vector<std::pair<int, T>>& items,
+                    std::vector<__BucketRange>& buckets, std::vector<T>& entries,
+                    int x0, int y0, int x1, int y1)
+  {
+    int region_w = x1 - x0;
+    std::vector<unsigned> fill((y1 - y0) * region_w + 1, 0);
+    for(auto& item: items)
+    {
+      int local = item.first % _locator_w - x0
+        + (item.first / _locator_w - y0) * region_w;
+      ++fill[local + 1];
+    }
+    unsigned base = entries.size();
+    for(unsigned n = 0; n + 1 < fill.size(); ++n)
+    {
+      fill[n + 1] += fill[n];
+      __BucketRange& bucket = buckets[x0 + n % region_w
+                                      + (y0 + n / region_w) * _locator_w];
+      bucket.begin = base + fill[n];
+      bucket.end = base + fill[n + 1];
+    }
+
+    entries.resize(base + items.size());
+    for(auto& item: items)
+    {
+      int local = item.first % _locator_w - x0
+        + (item.first / _locator_w - y0) * region_w;
+      entries[base + fill[local]++] = item.second;
+    }
+  }
+
+  //rebuckets triangles tris, which must be every live triangle reaching
+  //into the buckets x0 <= x < x1, y0 <= y < y1, in ascending order
+  void _fillLocator(const std::vector<int>& tris,
+                    int x0, int y0, int x1, int y1)
+  {
+    //slightly grown buckets keep points on bucket borders inside
+    constexpr float margin = 1. / 64.;
+
+    std::vector<std::pair<int, __LocatorEntry>> items;
+    for(int n: tris)
+    {
+      auto& tri = _navmesh_triangles[n];
+      NavMeshVert v0 = _navmesh_verts[tri.indices[0]];
+      NavMeshVert v1 = _navmesh_verts[tri.indices[1]];
+      NavMeshVert v2 = _navmesh_verts[tri.indices[2]];
+      if((v1.first - v0.first) * (v2.second - v0.second)
+        - (v1.second - v0.second) * (v2.first - v0.first) < 0.f)
+        std::swap(v1, v2);
+      __LocatorEntry entry = {{v0.first, v1.first, v2.first},
+                              {v0.second, v1.second, v2.second}, n};
+
+      float min_x = std::min(std::min(v0.first, v1.first), v2.first);
+      float max_x = std::max(std::max(v0.first, v1.first), v2.first);
+      float min_y = std::min(std::min(v0.second, v1.second), v2.second);
+      float max_y = std::max(std::max(v0.second, v1.second), v2.second);
+
+      int bx0 = std::max((int)(min_x - margin), x0);
+      int bx1 = std::min((int)(max_x + margin), x1 - 1);
+      int by0 = std::max((int)(min_y - margin), y0);
+      int by1 = std::min((int)(max_y + margin), y1 - 1);
+      for(int y = by0; y <= by1; ++y)
+      for(int x = bx0; x <= bx1; ++x)
+      {
+        if(_intersects(n, x - margin, x + 1 + margin,
+                        y + 1 + margin, y - margin))
+          items.push_back({x + y * _locator_w, entry});
+      }
+    }
+    _fillBuckets(items, _locator_buckets, _locator_entries, x0, y0, x1, y1);
+  }
+
+  void _buildLocator()
+  {
+    _locator_w = (_mapsize_w + 7) / 8;
+    _locator_h = (_mapsize_h + 7) / 8;
+
+    std::vector<int> tris(_navmesh_triangles.size());
+    for(unsigned n = 0; n < tris.size(); ++n)
+      tris[n] = n;
+    _locator_buckets.assign(_locator_w * _locator_h, {0, 0});
+    _locator_entries.clear();
+    _fillLocator(tris, 0, 0, _locator_w, _locator_h);
+  }
+
+  void _clearLocator()
+  {
+    _locator_entries.clear();
+    _locator_buckets.clear();
+    _locator_w = _locator_h = 0;
+  }
+
+  ///navmesh outline index
+  /*
+    the open triangle edges, bucketed in the locator's grid. a destination
+    off the mesh or on another component is moved to the nearest outline
+    point of the start's component, found by reading rings of buckets
+    around it until no unread bucket can hold a nearer edge.
+  */
+  struct __OutlineEdge
+  {
+    float x1, y1, x2, y2;
+    int triangle, component;
+  };
+
+  std::vector<__OutlineEdge> _outline_edges;
+  std::vector<__BucketRange> _outline_buckets;
+
+  //like _fillLocator, for the open edges of tris
+  void _fillOutlineIndex(const std::vector<int>& tris,
+                         int x0, int y0, int x1, int y1)
+  {
+    std::vector<std::pair<int, __OutlineEdge>> items;
+    for(int n: tris)
+    {
+      auto& tri = _navmesh_triangles[n];
+      for(int k = 0; k < 3; ++k)
+      {
+        if(tri.cons[k] != -1)
+          continue;
+        NavMeshVert v1 = _navmesh_verts[tri.indices[k]];
+        NavMeshVert v2 = _navmesh_verts[tri.indices[(k + 1) % 3]];
+        __OutlineEdge edge = {v1.first, v1.second, v2.first, v2.second,
+                              n, _getComponent(n)};
+
+        int bx0 = std::max((int)std::min(v1.first, v2.first), x0);
+        int bx1 = std::min((int)std::max(v1.first, v2.first), x1 - 1);
+        int by0 = std::max((int)std::min(v1.second, v2.second), y0);
+        int by1 = std::min((int)std::max(v1.second, v2.second), y1 - 1);
+        for(int y = by0; y <= by1; ++y)
+        for(int x = bx0; x <= bx1; ++x)
+          items.push_back({x + y * _locator_w, edge});
+      }
+    }
+    _fillBuckets(items, _outline_buckets, _outline_edges, x0, y0, x1, y1);
+  }
+
+  void _buildOutlineIndex()
+  {
+    std::vector<int> tris;
+    for(unsigned n = 0; n < _navmesh_triangles.size(); ++n)
+    {
+      if(!_navmesh_triangles[n].dead())
+        tris.push_back(n);
+    }
+    _outline_buckets.assign(_locator_w * _locator_h, {0, 0});
+    _outline_edges.clear();
+    _fillOutlineIndex(tris, 0, 0, _locator_w, _locator_h);
+  }
+
+  void _clearOutlineIndex()
+  {
+    _outline_edges.clear();
+    _outline_buckets.clear();
+  }
+
+  //moves x, y to the nearest point of the outline of component, or of any
+  //component if it is -1, just inside the triangle behind it, returns that
+  //triangle or -1
+  int _snapToComponent(int component, float& x, float& y)
+  {
+    if(_outline_buckets.empty())
+      return -1;
+
+    //bucket distances from the point clamped to the grid bound the
+    //distances from the point itself
+    float clamped_x = std::min(std::max(x, 0.f), _locator_w - 0.5f);
+    float clamped_y = std::min(std::max(y, 0.f), _locator_h - 0.5f);
+    int bucket_x = clamped_x;
+    int bucket_y = clamped_y;
+
+    int best = -1;
+    float best_sq_dist = 0.f, best_x = 0.f, best_y = 0.f;
+    auto readBucket = [&](int bx, int by)
+    {
+      const __BucketRange& bucket = _outline_buckets[bx + by * _locator_w];
+      for(unsigned n = bucket.begin; n < bucket.end; ++n)
+      {
+        const __OutlineEdge& e = _outline_edges[n];
+        if(component != -1 && e.component != component)
+          continue;
+        float dx = e.x2 - e.x1;
+        float dy = e.y2 - e.y1;
+        float ratio = ((x - e.x1) * dx + (y - e.y1) * dy)
+                      / (dx * dx + dy * dy);
+        ratio = std::min(std::max(ratio, 0.f), 1.f);
+        float px = e.x1 + dx * ratio;
+        float py = e.y1 + dy * ratio;
+        float sq_dist = (px - x) * (px - x) + (py - y) * (py - y);
+        if(best == -1 || sq_dist < best_sq_dist)
+        {
+          best = e.triangle;
+          best_sq_dist = sq_dist;
+          best_x = px;
+          best_y = py;
+        }
+      }
+    };
+
+    int max_ring = std::max(_locator_w, _locator_h);
+    for(int ring = 0; ring <= max_ring; ++ring)
+    {
+      int x0 = bucket_x - ring, x1 = bucket_x + ring;
+      int y0 = bucket_y - ring, y1 = bucket_y + ring;
+      for(int bx = std::max(x0, 0); bx <= std::min(x1, _locator_w - 1); ++bx)
+      {
+        if(y0 >= 0)
+          readBucket(bx, y0);
+        if(y1 < _locator_h && y1 != y0)
+          readBucket(bx, y1);
+      }
+      for(int by = std::max(y0 + 1, 0); by <= std::min(y1 - 1, _locator_h - 1); ++by)
+      {
+        if(x0 >= 0)
+          readBucket(x0, by);
+        if(x1 < _locator_w && x1 != x0)
+          readBucket(x1, by);
+      }
+      if(best != -1 && best_sq_dist <= (float)ring * ring)
+        break;
+    }
+    if(best == -1)
+      return -1;
+
+    //off the edge towards the center until the triangle holds the point
+    float center_x = _navmesh_triangles[best].center_x;
+    float center_y = _navmesh_triangles[best].center_y;
+    float step = 1. / 256.;
+    do
+    {
+      x = best_x + (center_x - best_x) * step;
+      y = best_y + (center_y - best_y) * step;
+      step *= 2.f;
+    }while(step < 1.f && !_contains(best, x, y));
+    if(step >= 1.f)
+    {
+      x = center_x;
+      y = center_y;
+    }
+    return best;
+  }
   //uint8_t* _obstacle_map = nullptr;
   //uint8_t* _area_map = nullptr;
 
@@ -366,7 +735,93 @@ namespace
   H3DRes _navmesh_mat = 0;
   H3DNode _navmesh_node = 0;
 
-  Utils::ArenaAllocator<sizeof(PathNode), 512> _pathnode_allocator;
+  ///path store
+  /*
+    the waypoints of all paths share one array. a path takes a span with a
+    power of two capacity, freed spans are listed per capacity and reused,
+    so storing and freeing paths does not allocate once the store has
+    grown.
+  */
+  constexpr int __path_size_classes = 24;
+
+  struct __PathSpan
+  {
+    unsigned ofset, length;
+    int size_class;
+  };
+
+  std::vector<PathPoint> _path_points;
+  std::vector<__PathSpan> _path_spans;      //span of handle n is n - 1
+  std::vector<WorldGeo::PathHandle> _free_path_handles;
+  std::vector<unsigned> _free_path_spans[__path_size_classes];
+
+  ///navmesh tiles
+  /*
+    the navmesh is triangulated per tile of __nav_tile_size cells. tiles
+    keep their triangulation until an edit marks them dirty, setupNavMesh
+    only rebuilds dirty tiles before assembling all tiles into the global
+    arrays and linking triangles across tile borders.
+  */
+  constexpr int __nav_tile_size = 64;
+
+  struct __NavTile
+  {
+    std::vector<NavMeshVert> verts;                 //in cells
+    std::vector<std::pair<int, int>> vert_cons;
+    std::vector<__NavMeshTriangle> triangles;
+    std::vector<int> plate_ofsets;
+    std::vector<int> plate_vert_ofsets;
+    std::vector<int> plates;                        //in the global arrays
+    std::vector<uint8_t> carved;    //obstacles per cell, empty if none
+    bool dirty = true;
+  };
+
+  std::vector<__NavTile> _nav_tiles;
+  int _nav_tiles_w = 0;
+  int _nav_tiles_h = 0;
+  BlockedMapT* _nav_tiles_map = nullptr;
+
+  inline bool _isCarved(int x, int y)
+  {
+    auto& carved = _nav_tiles[x / __nav_tile_size
+      + y / __nav_tile_size * _nav_tiles_w].carved;
+    return !carved.empty() && carved[x % __nav_tile_size
+      + y % __nav_tile_size * __nav_tile_size];
+  }
+
+  ///dynamic obstacles
+  /*
+    convex footprints blocking the cells whose centers they cover. the
+    tiles under a footprint are triangulated again and spliced into the
+    global arrays, the triangles they replace are killed. the navmesh is
+    compacted by a full assembly once the dead triangles make up a third.
+  */
+  struct __Obstacle
+  {
+    std::vector<int> cells;
+    int x_begin, y_begin, x_end, y_end;     //cell bounds
+  };
+
+  //slot n holds obstacle id n + 1
+  std::vector<std::unique_ptr<__Obstacle>> _obstacles;
+  unsigned _dead_triangles = 0;
+
+  //open triangle edge on a tile border, lower vertex index first
+  struct __BorderEdge
+  {
+    int vert1, vert2;
+    int triangle, con;
+
+    bool operator<(const __BorderEdge& other) const
+    {
+      if(vert1 != other.vert1) return vert1 < other.vert1;
+      return vert2 < other.vert2;
+    }
+    bool operator==(const __BorderEdge& other) const
+    {
+      return vert1 == other.vert1 && vert2 == other.vert2;
+    }
+  };
 }
 
 
@@ -483,26 +938,6 @@ class NMC_Plate: public BlockedMapT
       }while(ptr);
       return false;
     }
-    
-    friend __VertCon* getCommonConnection
-        (const __VertCon& a, const __VertCon& b, const __VertCon& c)
-    {
-      const __VertCon* a_ptr = &a;
-      do
-      {
-        for(auto con: a_ptr->connections)
-        {
-          if(con != nullptr)
-          {
-            if(con == &c)
-              continue;
-            else if(isConnected(*con, b)) return con;
-          }
-        }
-        a_ptr = a_ptr->more;
-      }while(a_ptr);
-      return nullptr;
-    }
   };
 
   std::pair<uint16_t, uint16_t> _main_plate;
@@ -511,11 +946,127 @@ class NMC_Plate: public BlockedMapT
   mutable std::vector<__NavMeshTriangle> _triangles;
   unsigned _width;
 
+  /*
+    bounds of the tile the plate was cut from and the lattice points on its
+    border which have to become vertices, in the order top, bottom, left,
+    right. neighbouring tiles flag the same points so their border edges
+    match.
+  */
+  int _tile_x0, _tile_y0, _tile_x1, _tile_y1;
+  std::vector<bool> _border_breaks;
+
+  /*
+    outlines are simplified by cutting corners, which on thin or diagonal
+    plates can fold an outline onto itself or across another one. such
+    plates are listed again with every corner of their cells.
+  */
+  bool _exact_outlines = false;
+  bool _outlines_simple = true;
+
+  static double _orientation(__Coords a, __Coords b, __Coords c)
+  {
+    return (b.first - a.first) * (c.second - a.second)
+          - (b.second - a.second) * (c.first - a.first);
+  }
+
+  //for p on the line through a and b
+  static bool _onSegment(__Coords a, __Coords b, __Coords p)
+  {
+    return std::min(a.first, b.first) <= p.first
+      && p.first <= std::max(a.first, b.first)
+      && std::min(a.second, b.second) <= p.second
+      && p.second <= std::max(a.second, b.second);
+  }
+
+  //whether outline edges a-b and c-d meet anywhere but a shared vertex
+  bool _edgesTouch(int a, int b, int c, int d) const
+  {
+    const __Coords &va = _vertices[a], &vb = _vertices[b];
+    const __Coords &vc = _vertices[c], &vd = _vertices[d];
+
+    //edges following each other only meet again when the outline folds
+    if(b == c)
+      return _orientation(va, vb, vd) == 0.
+        && _dotProduct(va - vb, vd - vb) > 0.;
+    if(d == a)
+      return _orientation(vc, vd, vb) == 0.
+        && _dotProduct(vc - va, vb - va) > 0.;
+
+    double o1 = _orientation(va, vb, vc);
+    double o2 = _orientation(va, vb, vd);
+    double o3 = _orientation(vc, vd, va);
+    double o4 = _orientation(vc, vd, vb);
+    if(o1 * o2 < 0. && o3 * o4 < 0.)
+      return true;
+    return (o1 == 0. && _onSegment(va, vb, vc))
+      || (o2 == 0. && _onSegment(va, vb, vd))
+      || (o3 == 0. && _onSegment(vc, vd, va))
+      || (o4 == 0. && _onSegment(vc, vd, vb));
+  }
+
+  //whether any two outline edges touch, swept along x
+  bool _outlinesCross() const
+  {
+    std::vector<std::pair<float, int>> edges;
+    edges.reserve(_vertices.size());
+    for(unsigned n = 0; n < _vertices.size(); ++n)
+      edges.push_back({std::min(_vertices[n].first,
+                        _vertices[_vertices[n].second_con].first), n});
+    std::sort(edges.begin(), edges.end());
+
+    for(unsigned i = 0; i < edges.size(); ++i)
+    {
+      int a = edges[i].second;
+      int b = _vertices[a].second_con;
+      float max_x = std::max(_vertices[a].first, _vertices[b].first);
+      for(unsigned j = i + 1; j < edges.size() && edges[j].first <= max_x; ++j)
+      {
+        int c = edges[j].second;
+        if(_edgesTouch(a, b, c, _vertices[c].second_con))
+          return true;
+      }
+    }
+    return false;
+  }
+
+  bool _isBorderBreak(int x, int y) const
+  {
+    if(_border_breaks.empty())
+      return false;
+
+    int w = _tile_x1 - _tile_x0 + 1;
+    int h = _tile_y1 - _tile_y0 + 1;
+    if(x >= _tile_x0 && x <= _tile_x1)
+    {
+      if(y == _tile_y0 && _border_breaks[x - _tile_x0])
+        return true;
+      if(y == _tile_y1 && _border_breaks[w + x - _tile_x0])
+        return true;
+    }
+    if(y >= _tile_y0 && y <= _tile_y1)
+    {
+      if(x == _tile_x0 && _border_breaks[w * 2 + y - _tile_y0])
+        return true;
+      if(x == _tile_x1 && _border_breaks[w * 2 + h + y - _tile_y0])
+        return true;
+    }
+    return false;
+  }
+
   public:
 
   NMC_Plate(unsigned w): _width(w)
   {this->reset();}
 
+  void setTile(int x0, int y0, int x1, int y1, std::vector<bool>&& breaks)
+  {
+    _tile_x0 = x0;
+    _tile_y0 = y0;
+    _tile_x1 = x1;
+    _tile_y1 = y1;
+    _border_breaks = std::move(breaks);
+  }
+
   void setStart(uint16_t x, uint16_t y)
   {_main_plate = {x, y};}
   void setHole(uint16_t x, uint16_t y)
@@ -524,7 +1075,13 @@ class NMC_Plate: public BlockedMapT
   void listVertices(int x, int y, bool is_hole)
   {
     //list vertices
-    std::vector<__Coords> helper;
+    //every corner and border break of the outline, for exact outlines
+    std::vector<__Coords> corners;
+    auto addCorner = [&](__Coords corner)
+    {
+      if(corners.empty() || corners.back() != corner)
+        corners.push_back(corner);
+    };
 
     int seeker_x = x;
     int seeker_y = y;
@@ -542,18 +1099,47 @@ class NMC_Plate: public BlockedMapT
     uint16_t last_dir = ce_east;
 
     NavMeshVert break_vert, comp_vert, current_vert;
+    NavMeshVert turn_vert;
+    bool has_turn = false;
 
     //setup init state
     break_vert = {seeker_x, seeker_y};
     comp_vert = {0., 0.};
-    current_vert = {1., 0.};
     _vertices.push_back(break_vert);
+    addCorner(break_vert);
 
-    ++seeker_x;
-    if(!(*this)[seeker_x + seeker_y * _width])
+    //holes start down the left side of their first cell, so the plate
+    //stays on the right also when the top row is a single cell
+    if(is_hole)
+    {
+      current_vert = {0., 1.};
+      ++seeker_y;
       direction = ce_south;
-    else if((*this)[seeker_x + (seeker_y - 1) * _width])
-      direction = ce_north;
+      if(!(*this)[seeker_x - 1 + seeker_y * _width])
+        direction = ce_west;
+      else if((*this)[seeker_x + seeker_y * _width])
+        direction = ce_east;
+      if(direction != ce_south)
+        addCorner({seeker_x, seeker_y});
+    }
+    else
+    {
+      current_vert = {1., 0.};
+      ++seeker_x;
+      if(_isBorderBreak(seeker_x, seeker_y))
+      {
+        break_vert = {seeker_x, seeker_y};
+        _vertices.push_back(break_vert);
+        addCorner(break_vert);
+        current_vert = {0., 0.};
+      }
+      if(!(*this)[seeker_x + seeker_y * _width])
+        direction = ce_south;
+      else if((*this)[seeker_x + (seeker_y - 1) * _width])
+        direction = ce_north;
+      if(direction != ce_east)
+        addCorner({seeker_x, seeker_y});
+    }
     last_dir = direction;
 
     do
@@ -598,10 +1184,30 @@ class NMC_Plate: public BlockedMapT
       current_vert = {seeker_x - break_vert.first,
                       seeker_y - break_vert.second};
 
-      if(current_n > 3 && std::fabs(_dotProduct(comp_vert, current_vert)) > 4.)
+      if(_isBorderBreak(seeker_x, seeker_y)
+        && (seeker_x != x || seeker_y != y))
+      {
+        //keep the last corner, the edge to the border would cut it
+        if(has_turn && _dotProduct(_turn90d(turn_vert - break_vert),
+                                  NavMeshVert(seeker_x, seeker_y) - break_vert)
+                        != 0.)
+          _vertices.push_back(turn_vert);
+        has_turn = false;
+
+        break_vert = {seeker_x, seeker_y};
+        _vertices.push_back(break_vert);
+        addCorner(break_vert);
+        current_vert = {0., 0.};
+        comp_vert = {0., 0.};
+        current_n = 0;
+      }
+      else if(current_n > 3
+        && std::fabs(_dotProduct(comp_vert, current_vert)) > 4.)
       {
         break_vert = {seeker_x, seeker_y};
-        switch(last_dir)
+        if(has_turn)
+          break_vert = turn_vert;
+        else switch(last_dir)
         {
         case ce_north:
           break_vert.second += 1.;
@@ -622,12 +1228,29 @@ class NMC_Plate: public BlockedMapT
                         seeker_y - break_vert.second};
         comp_vert = {0., 0.};
         current_n = 0;
+        has_turn = false;
+      }
+
+      if(direction != last_dir)
+      {
+        turn_vert = {seeker_x, seeker_y};
+        has_turn = true;
+        if(seeker_x != x || seeker_y != y)
+          addCorner(turn_vert);
       }
 
       last_dir = direction;
 
     }while(seeker_x != x || seeker_y != y);
 
+    //a few cells can simplify to less than a triangle
+    if(_vertices.size() - first_vert < 3)
+      _outlines_simple = false;
+    if(_exact_outlines)
+    {
+      _vertices.erase(_vertices.begin() + first_vert, _vertices.end());
+      _vertices.insert(_vertices.end(), corners.begin(), corners.end());
+    }
 
     int last_vert = _vertices.size() - 1;
 
@@ -643,11 +1266,21 @@ class NMC_Plate: public BlockedMapT
 
   void listVertices()
   {
-    listVertices(_main_plate.first, _main_plate.second, false);
-    for(auto coord: _holes)
+    _exact_outlines = false;
+    _outlines_simple = true;
+    do
     {
-      listVertices(coord.first, coord.second, true);
-    }
+      listVertices(_main_plate.first, _main_plate.second, false);
+      for(auto coord: _holes)
+      {
+        listVertices(coord.first, coord.second, true);
+      }
+      if(_exact_outlines || (_outlines_simple && !_outlinesCross()))
+        break;
+
+      _vertices.clear();
+      _exact_outlines = true;
+    }while(true);
   }
   
   //helper function for constraints
@@ -778,6 +1411,11 @@ class NMC_Plate: public BlockedMapT
     {return (float)(right.second - left.second)
       / (float)(right.first - left.first);};
 
+    ///and one for the side of a line a point lies on, negative is right
+    auto getSide = [](__Coords a, __Coords b, __Coords p)->double
+    {return ((double)b.first - a.first) * ((double)p.second - a.second)
+      - ((double)b.second - a.second) * ((double)p.first - a.first);};
+
     constexpr float theta = .000001;
 
     if(_vertices.size() < 3) return;
@@ -969,81 +1607,37 @@ class NMC_Plate: public BlockedMapT
         right = m + n >= num_sub_seq? 
           sub_seq[num_sub_seq] : sub_seq[m + n];
 
-        ///find lowest
-        low_l = left; low_r = middle;
-        for(int v = left + 1; v < middle; ++v)
+        ///find lower common tangent
+        //the base edge has no vertex below it, of collinear vertices
+        //the ones closest to the other half are taken
+        low_l = middle - 1;
+        low_r = middle;
         {
-          if(_vertices[low_l].second >= _vertices[v].second)
-            low_l = v;
-        }
-        for(int v = middle + 1; v < right; ++v)
-        {
-          if(_vertices[low_r].second > _vertices[v].second)
-            low_r = v;
-        }
-
-        {
-          float temp = getAngleCoef(_vertices[low_l], _vertices[low_r]);
-          float temp2;
-
-          //positive angle
-          if(temp > 0.)
+          bool moved;
+          do
           {
-            int old_low_l;
-            do
+            moved = false;
+            for(int v = left; v < middle; ++v)
             {
-              old_low_l = low_l;
-              for(int v = low_r + 1; v < right; ++v)
-              {
-                temp2 = getAngleCoef(_vertices[low_l],
+              double side = getSide(_vertices[low_l], _vertices[low_r],
                                     _vertices[v]);
-                if(temp2 < temp)
-                {
-                  low_r = v;
-                  temp = temp2;
-                }
-              }
-              for(int v = low_l + 1; v < middle; ++v)
+              if(side < 0. || (side == 0. && v > low_l))
               {
-                temp2 = getAngleCoef(_vertices[v],
-                      _vertices[low_r]);
-                if(temp2 >= temp)
-                {
-                  low_l = v;
-                  temp = temp2;
-                }
+                low_l = v;
+                moved = true;
               }
-            }while(old_low_l != low_l);
-          }
-          //negative angle
-          else if(temp < 0.)
-          {
-            int old_low_r;
-            do
+            }
+            for(int v = middle; v < right; ++v)
             {
-              old_low_r = low_r;
-              for(int v = low_l - 1; v >= left; --v)
+              double side = getSide(_vertices[low_l], _vertices[low_r],
+                                    _vertices[v]);
+              if(side < 0. || (side == 0. && v < low_r))
               {
-                temp2 = getAngleCoef(_vertices[v],
-                                    _vertices[low_r]);
-                if(temp2 > temp)
-                {
-                  low_l = v;
-                  temp = temp2;
-                }
+                low_r = v;
+                moved = true;
               }
-              for(int v = low_r - 1; v >= middle; --v)
-              {
-                temp2 = getAngleCoef(_vertices[low_l],
-                                    _vertices[v]);
-                if(temp2 <= temp)
-                {
-                  low_r = v;
-                  temp = temp2;
-                }
-              }
-            }while(old_low_r != low_r);
-          }
+            }
+          }while(moved);
         }
 
         ///sewing loop
@@ -1210,6 +1804,45 @@ class NMC_Plate: public BlockedMapT
       }
     }
     
+    /*
+      finds the vertex across edge l-r from vertex last. l and r may have
+      more common connections on that side, enclosing other vertices, the
+      one forming a triangle with l-r has the smallest angle at l.
+    */
+    auto getOpposite = [&](int l, int r, int last)->int
+    {
+      double last_side = getSide(_vertices[l], _vertices[r], _vertices[last]);
+      std::complex<double> edge = {
+        _vertices[r].first - _vertices[l].first,
+        _vertices[r].second - _vertices[l].second};
+
+      std::vector<intptr_t> l_cons;
+      vert_cons[l].listConnections(l_cons);
+
+      int opposite = -1;
+      double min_angle = 10.;
+      for(auto i: l_cons)
+      {
+        intptr_t j = i - (intptr_t)vert_cons;
+        j /= sizeof(__VertCon);
+
+        if(j == r || !isConnected(vert_cons[j], vert_cons[r]))
+          continue;
+        if(getSide(_vertices[l], _vertices[r], _vertices[j]) * last_side >= 0.)
+          continue;
+
+        double angle = std::fabs(std::arg(std::complex<double>(
+          _vertices[j].first - _vertices[l].first,
+          _vertices[j].second - _vertices[l].second) / edge));
+        if(angle < min_angle)
+        {
+          min_angle = angle;
+          opposite = j;
+        }
+      }
+      return opposite;
+    };
+
     //insert constraints
     /*
       possible corner case when contraint of an inner plate crosses
@@ -1285,27 +1918,23 @@ class NMC_Plate: public BlockedMapT
           printf("not connected.\n");*/
         
         //list cons
-        __VertCon *next_con, *last_con;
-        last_con = &vert_cons[curr];
-        while((next_con = getCommonConnection(vert_cons[l_con],
-              vert_cons[r_con], *last_con)) != vert_cons + targ)
+        int next_con, last_con;
+        last_con = curr;
+        while((next_con = getOpposite(l_con, r_con, last_con)) != targ)
         {
-          intptr_t j = (intptr_t)next_con - (intptr_t)vert_cons;
-          j /= sizeof(__VertCon);
-          
           if(std::arg(std::complex<double>(
-            _vertices[j].first - _vertices[curr].first,
-            _vertices[j].second - _vertices[curr].second)
+            _vertices[next_con].first - _vertices[curr].first,
+            _vertices[next_con].second - _vertices[curr].second)
             / main_comp) > 0.)
           {
-            last_con = &vert_cons[l_con];
-            l_con = j;
+            last_con = l_con;
+            l_con = next_con;
             left_side.push_back(l_con);
           }
           else
           {
-            last_con = &vert_cons[r_con];
-            r_con = j;
+            last_con = r_con;
+            r_con = next_con;
             right_side.push_back(r_con);
           }
         }
@@ -1463,7 +2092,7 @@ class NMC_Plate: public BlockedMapT
   delete[] vert_cons;
   }
 
-  void clear(){_vertices.clear(); _triangles.clear();}
+  void clear(){_vertices.clear(); _triangles.clear(); _holes.clear();}
   /*void push_back_v(__Coords c)
   {
     _vertices.push_back(__CoordsAngles(c));
@@ -1483,29 +2112,6 @@ class NMC_Plate: public BlockedMapT
 //end navmesh plate
 
 
-///PathNode memory allocation overloads
-PathNode* PathNode::advance()
-{
-  auto ret = next;
-  next = nullptr;
-  delete this;
-  return ret;
-}
-
-//int pn_counter = 0;
-
-void* PathNode::operator new(size_t size)
-{
-  //++pn_counter;
-  return _pathnode_allocator.getAdress();
-}
-
-void PathNode::operator delete(void* adress)
-{
-  //--pn_counter;
-  _pathnode_allocator.freeAdress(adress);
-}
-
 namespace
 {
   constexpr int __pts_per_unit = 100;
@@ -1521,6 +2127,7 @@ namespace
       closed  = 2
     };
 
+    uint32_t generation;
     int status;
     int travel_len;
     int prev;
@@ -1533,25 +2140,148 @@ namespace
     }
   };
 
-  __Status* _status_map = nullptr;
-
-  struct __OpenTriangle
+  /*
+    search state for every navmesh triangle.
+    entries are stamped with the generation of the query that last touched
+    them, anything stamped by an older query reads as unused. this way
+    starting a search never has to walk the whole map.
+  */
+  class __StatusMap
   {
-    int triangle;
-    int heuristic;
-    __OpenTriangle(int t, int h): triangle(t), heuristic(h){}
-    bool operator<(const __OpenTriangle& other) const
+    __Status* _map = nullptr;
+    unsigned _size = 0;
+    uint32_t _generation = 0;
+
+  public:
+
+    void create(unsigned size)
+    {
+      delete[] _map;
+      _map = new __Status[size];
+      _size = size;
+      clear();
+    }
+    //keeps the map if it is large enough, grows it by half otherwise
+    void reserve(unsigned size)
+    {
+      if(size > _size)
+        create(size + size / 2);
+    }
+    void destroy()
+    {
+      delete[] _map;
+      _map = nullptr;
+      _size = 0;
+    }
+
+    void clear()
+    {
+      for(unsigned n = 0; n < _size; ++n)
+        _map[n].generation = 0;
+      _generation = 0;
+    }
+
+    //invalidates all entries, only walks the map when the counter wraps
+    void nextGeneration()
+    {
+      if(++_generation == 0)
+      {
+        clear();
+        _generation = 1;
+      }
+    }
+
+    __Status& operator[](int idx)
     {
-      return heuristic > other.heuristic;
+      __Status& entry = _map[idx];
+      if(entry.generation != _generation)
+      {
+        entry.generation = _generation;
+        entry.status = __Status::unused;
+      }
+      return entry;
     }
+
+    __StatusMap(){}
+    __StatusMap(const __StatusMap&) = delete;
+    ~__StatusMap(){delete[] _map;}
   };
 
-  /*bool operator<(__OpenTriangle& a, __OpenTriangle& b)
+
+  /*
+    open list of the triangle search, which never lowers the key of an open
+    triangle. without decreases, keeping the index of the CFHeap costs more
+    than it saves, so this is a plain binary heap of (triangle, key) entries.
+    clear() pops instead of reallocating, so the storage is kept.
+  */
+  class __OpenQueue
   {
-    return a.heuristic < b.heuristic;
-  }*/
+    struct __Entry
+    {
+      int triangle;
+      int key;
+      bool operator<(const __Entry& other) const
+      {
+        return key > other.key;
+      }
+    };
+
+    std::priority_queue<__Entry> _queue;
+
+  public:
+
+    void push(int triangle, int key){_queue.push(__Entry{triangle, key});}
+    int top() const {return _queue.top().triangle;}
+    void pop(){_queue.pop();}
+    bool empty() const {return _queue.empty();}
+    void clear(){while(!_queue.empty()) _queue.pop();}
+  };
+
+  //search state owned by one thread, the main thread and every path worker
+  //have their own so searches can run concurrently
+  struct __SearchScratch
+  {
+    __StatusMap status_map;
+    __OpenQueue open_queue;         //triangle search
+    Utils::CFHeap<int> open_heap;   //searches that lower keys
+    std::vector<std::pair<int, int>> funnel;
+    std::vector<NavMeshVert> path;
+
+    //hierarchical search
+    __StatusMap from_map, to_map, gate_map;
+    std::vector<int> gates, corridor, segment;
+  };
+
+  __SearchScratch _main_scratch;
+
+  ///asynchronous path requests
+  struct __PathRequest
+  {
+    PathRequestId id;
+    unsigned tick;
+    void* owner;
+    float x_start, y_start, x_dest, y_dest;
+    float radius;
+
+    std::atomic<bool> cancelled;
+    bool done;
+    bool found;
+    std::vector<NavMeshVert> path;
+  };
+
+  //requests in id order, results are handed out from the front
+  std::deque<std::unique_ptr<__PathRequest>> _path_requests;
+  PathRequestId _next_path_request_id = 1;
+  unsigned _path_tick = 0;
+
+  std::mutex _path_mutex;
+  std::condition_variable _path_done_cond;
+  //set while the navmesh changes, searches starting meanwhile are skipped
+  std::atomic<bool> _path_requests_held(false);
+
+  std::unique_ptr<__SearchScratch[]> _worker_scratch;
+  std::unique_ptr<Utils::ThreadPool> _path_workers;   //joined before the scratch is freed
 
-  std::priority_queue<__OpenTriangle> _open_heap;
   
   template<class T>
   class __SquaredDistFunctor
@@ -1577,153 +2307,37 @@ namespace
       return this->operator()(v[0], v[1]);
     }
   };
-}
 
-///
-namespace WorldGeo
-{
+  //finds the destination triangle, a destination outside of component is
+  //moved onto the nearest outline point of component
+  int _locateDestination(int component, float& x_dest, float& y_dest)
+  {
+    int to;
+    if((to = _locateTriangle(x_dest, y_dest)) == -1 ||
+        component != _getComponent(to))
+      to = _snapToComponent(component, x_dest, y_dest);
+
+    return to;
+  }
+
   /*
-    the following code implements the A* algorithm
+    expands triangles outwards from from, ordered by travel length plus
+    heuristic, until done returns true for a popped triangle.
+    the prev entries in the status map form a tree rooted in from.
+    open_list takes push(triangle, key), top(), pop(), empty() and clear().
   */
-
-  PathNode* findPath(float x_start, float y_start, float x_dest, float y_dest)
+  template<class O, class H, class D>
+  bool _searchTrianglesIn(O& open_list, __SearchScratch& scratch, int from,
+                          H heuristic, D done, float width = 0.f)
   {
-    /*
-      possible optimizations:
-        Paths between crossroads can be precalculated.
-        Finding of nearest destination triangles in case of miss can be mapped.
-        triangles along plate edges can be precalculated
-    */
-    
-    auto dest_dist = [x_dest, y_dest](float x, float y)
-    {
-      x -= x_dest;
-      y -= y_dest;
-      return sqrt(x * x + y * y) * __pts_per_unit;
-    };
-
-    int from = 0;
-    int to = 0;
     int current = 0;
     int travel_len = 0;
+    bool found = false;
 
-    if((from = _nav_mesh_triangle_tree.retrieve(x_start, y_start)) == -1)
-    {
-#ifndef NDEBUG
-      printf("findPath: start point not found in nav_mesh_triangle_tree.\n"
-            "%s: %i\n", __FILE__, __LINE__);
-#endif
-      return nullptr;
-    }
-    int from_plate = _getPlate(from);
-    if((to = _nav_mesh_triangle_tree.retrieve(x_dest, y_dest)) == -1 ||
-        from_plate != _getPlate(to))
-    {
-      //helper functor
-      /*auto get_squared_dist = [x_dest, y_dest](__NavMeshTriangle& tri)->float
-      {
-        float x_diff = tri.center_x - x_dest;
-        float y_diff = tri.center_y - y_dest;
-        return x_diff * x_diff + y_diff * y_diff;
-      };*/
-      __SquaredDistFunctor<decltype(NavMeshVert::first)>
-        get_squared_dist(x_dest, y_dest);
-      
-      /*
-        note:
-        equation for finding nearest point on a line to nother point
-          -l = ((x1 - x2)(x2 - x0) + (y1 - y2)(y2 - y0))/
-                      ((x1 - x2)^2 + (y1 - y2)^2)
-        where:
-          x0 = point to compare to
-          x1 = first point on line
-          x2 = second point on line
-          l = ratio of nearest point from x1 to x2
-        
-        also note: this is not tested
-      */
-      
-      //find nearest triangle
-      /*to = _plate_ofsets[from_plate];
-      float squared_dist = get_squared_dist(_navmesh_triangles[to]);
-      for(int curr_idx = _plate_ofsets[from_plate] + 1;
-          curr_idx != _plate_ofsets[from_plate + 1];
-          ++curr_idx)
-      {
-        float curr_sq_dist = get_squared_dist(_navmesh_triangles[curr_idx]);
-        if(curr_sq_dist < squared_dist)
-        {
-          squared_dist = curr_sq_dist;
-          to = curr_idx;
-        }
-      }*/
-      
-      //find nearest vert
-      int v_temp = _plate_vert_ofsets[from_plate];
-      float squared_dist = get_squared_dist(_navmesh_verts[v_temp]);
-      for(int temp_idx = _plate_vert_ofsets[from_plate] + 1;
-          temp_idx != _plate_vert_ofsets[from_plate + 1];
-          ++temp_idx)
-      {
-        float temp_sq_dist = get_squared_dist(_navmesh_verts[temp_idx]);
-        if(temp_sq_dist < squared_dist)
-        {
-          squared_dist = temp_sq_dist;
-          v_temp = temp_idx;
-        }
-      }
-      
-      //find nearest triangle
-      {
-        int v_temp1 = _navmesh_vert_cons[v_temp].first;
-        int v_temp2 = _navmesh_vert_cons[v_temp].second;
-      
-        std::complex<double> main_vert, first_vert, second_vert;
-        main_vert = {x_dest - _navmesh_verts[v_temp].first,
-                      y_dest - _navmesh_verts[v_temp].second};
-        first_vert = 
-          {_navmesh_verts[v_temp1].first - _navmesh_verts[v_temp].first,
-          _navmesh_verts[v_temp1].second - _navmesh_verts[v_temp].second};
-        second_vert = 
-          {_navmesh_verts[v_temp2].first - _navmesh_verts[v_temp].first,
-          _navmesh_verts[v_temp2].second - _navmesh_verts[v_temp].second};
-        
-        if(std::abs(std::arg(main_vert / first_vert)) <
-            std::abs(std::arg(main_vert / second_vert)))
-          to = std::find_if(
-            _navmesh_triangles.begin() + _plate_ofsets[from_plate],
-            _navmesh_triangles.begin() + _plate_ofsets[from_plate + 1],
-            [=](const __NavMeshTriangle& tri)
-            {return tri.hasVerts(v_temp, v_temp1);})
-            - _navmesh_triangles.begin();
-          else to = std::find_if(
-            _navmesh_triangles.begin() + _plate_ofsets[from_plate],
-            _navmesh_triangles.begin() + _plate_ofsets[from_plate + 1],
-            [=](const __NavMeshTriangle& tri)
-            {return tri.hasVerts(v_temp, v_temp2);})
-            - _navmesh_triangles.begin();
-      }
-      
-      float center_x = _navmesh_triangles[to].center_x;
-      float center_y = _navmesh_triangles[to].center_y;
-      
-      do
-      {
-        x_dest = (x_dest * 4 + center_x) / 5;
-        y_dest = (y_dest * 4 + center_y) / 5;
-      }while(!_contains(to, x_dest, y_dest));
-    }
-    
-
-    if(from == to)
-      return new PathNode(x_dest, y_dest, nullptr);
-
-    //memset(_status_map, __Status::unused, _navmesh_triangles.size());
-    for(unsigned n = 0; n < _navmesh_triangles.size(); ++n)
-      _status_map[n].status = __Status::unused;
+    scratch.status_map.nextGeneration();
 
     //list first candidates
-    _status_map[from].setAll(__Status::closed, 0, -1);
+    scratch.status_map[from].setAll(__Status::closed, 0, -1);
 
     {
       int i;
@@ -1731,161 +2345,385 @@ namespace WorldGeo
       {
         travel_len = (_navmesh_triangles[from].dists[0] 
                     + _navmesh_triangles[from].dists[2]) / 2;
-        _status_map[i].setAll(__Status::open, travel_len, from);
-        _open_heap.push(__OpenTriangle(i,
-        dest_dist(_navmesh_triangles[i].center_x,
-                    _navmesh_triangles[from].center_y) + travel_len));
+        scratch.status_map[i].setAll(__Status::open, travel_len, from);
+        open_list.push(i,
+        heuristic(_navmesh_triangles[i].center_x,
+                    _navmesh_triangles[from].center_y) + travel_len);
       }
       if((i = _navmesh_triangles[from].cons[1]) != -1)
       {
         travel_len = (_navmesh_triangles[from].dists[1]
                     + _navmesh_triangles[from].dists[0]) / 2;
-        _status_map[i].setAll(__Status::open, travel_len, from);
-        _open_heap.push(__OpenTriangle(i,
-        dest_dist(_navmesh_triangles[i].center_x,
-                    _navmesh_triangles[from].center_y) + travel_len));
+        scratch.status_map[i].setAll(__Status::open, travel_len, from);
+        open_list.push(i,
+        heuristic(_navmesh_triangles[i].center_x,
+                    _navmesh_triangles[from].center_y) + travel_len);
       }
       if((i = _navmesh_triangles[from].cons[2]) != -1)
       {
         travel_len = (_navmesh_triangles[from].dists[2]
                     + _navmesh_triangles[from].dists[1]) / 2;
-        _status_map[i].setAll(__Status::open, travel_len, from);
-        _open_heap.push(__OpenTriangle(i,
-        dest_dist(_navmesh_triangles[i].center_x,
-                    _navmesh_triangles[from].center_y) + travel_len));
+        scratch.status_map[i].setAll(__Status::open, travel_len, from);
+        open_list.push(i,
+        heuristic(_navmesh_triangles[i].center_x,
+                    _navmesh_triangles[from].center_y) + travel_len);
       }
     }
 
-    while(!_open_heap.empty())
+    while(!open_list.empty())
     {
-      current = _open_heap.top().triangle;
-      _open_heap.pop();
-      if(current == to) break;
+      current = open_list.top();
+      open_list.pop();
+      if(done(current))
+      {
+        found = true;
+        break;
+      }
 
-      _status_map[current].status = __Status::closed;
+      scratch.status_map[current].status = __Status::closed;
 
-      //push new connections unto open_heap
+      //push new connections unto open_list
       auto& tri = _navmesh_triangles[current];
       int prev_con;
       int temp_con1, temp_con2;
-      if(tri.cons[0] == _status_map[current].prev) prev_con = 0;
-      else if(tri.cons[1] == _status_map[current].prev) prev_con = 1;
+      if(tri.cons[0] == scratch.status_map[current].prev) prev_con = 0;
+      else if(tri.cons[1] == scratch.status_map[current].prev) prev_con = 1;
       else prev_con = 2;
 
       temp_con1 = tri.cons[(prev_con + 1) % 3];
       temp_con2 = tri.cons[(prev_con + 2) % 3];
 
+      //crossings too narrow for the unit are left out
+      if(tri.clearance[prev_con] < width)
+        temp_con1 = -1;
+      if(tri.clearance[(prev_con + 2) % 3] < width)
+        temp_con2 = -1;
+
       //check for closed triangles tangents
       if(temp_con1 != -1
-        && _status_map[temp_con1].status == __Status::closed)
+        && scratch.status_map[temp_con1].status == __Status::closed)
       {
-        int sec_prev_con = _status_map[temp_con1].prev;
+        int sec_prev_con = scratch.status_map[temp_con1].prev;
         auto& temp_tri = _navmesh_triangles[temp_con1];
         if(sec_prev_con == temp_tri.cons[0]) sec_prev_con = 0;
         else if(sec_prev_con == temp_tri.cons[1]) sec_prev_con = 1;
         else sec_prev_con = 2;
 
-        travel_len = _status_map[temp_con1].travel_len;
+        travel_len = scratch.status_map[temp_con1].travel_len;
+        int crossing = (sec_prev_con + 2) % 3;
         if(current == temp_tri.cons[(sec_prev_con + 1) % 3])
+        {
           travel_len += temp_tri.dists[(sec_prev_con + 1) % 3];
+          crossing = sec_prev_con;
+        }
         else travel_len += temp_tri.dists[(sec_prev_con + 2) % 3];
 
-        if(travel_len < _status_map[current].travel_len)
+        if(travel_len < scratch.status_map[current].travel_len
+          && temp_tri.clearance[crossing] >= width)
         {
-          _status_map[current].travel_len = travel_len;
-          _status_map[current].prev = temp_con1;
+          scratch.status_map[current].travel_len = travel_len;
+          scratch.status_map[current].prev = temp_con1;
         }
 
         temp_con1 = -1;
       }
       if(temp_con2 != -1
-        && _status_map[temp_con2].status == __Status::closed)
+        && scratch.status_map[temp_con2].status == __Status::closed)
       {
-        int sec_prev_con = _status_map[temp_con1].prev;
+        int sec_prev_con = scratch.status_map[temp_con2].prev;
         auto& temp_tri = _navmesh_triangles[temp_con2];
         if(sec_prev_con == temp_tri.cons[0]) sec_prev_con = 0;
         else if(sec_prev_con == temp_tri.cons[1]) sec_prev_con = 1;
         else sec_prev_con = 2;
 
-        travel_len = _status_map[temp_con2].travel_len;
+        travel_len = scratch.status_map[temp_con2].travel_len;
+        int crossing = (sec_prev_con + 2) % 3;
         if(current == temp_tri.cons[(sec_prev_con + 1) % 3])
+        {
           travel_len += temp_tri.dists[(sec_prev_con + 1) % 3];
+          crossing = sec_prev_con;
+        }
         else travel_len += temp_tri.dists[(sec_prev_con + 2) % 3];
 
-        if(travel_len < _status_map[current].travel_len)
+        if(travel_len < scratch.status_map[current].travel_len
+          && temp_tri.clearance[crossing] >= width)
         {
-          _status_map[current].travel_len = travel_len;
-          _status_map[current].prev = temp_con2;
+          scratch.status_map[current].travel_len = travel_len;
+          scratch.status_map[current].prev = temp_con2;
         }
 
         temp_con2 = -1;
       }
 
       //push new open triangles
-      if(temp_con1 != -1 
-        && _status_map[temp_con1].status == __Status::unused)
+      if(temp_con1 != -1
+        && scratch.status_map[temp_con1].status == __Status::unused)
       {
         travel_len = tri.dists[prev_con]
-                    + _status_map[current].travel_len;
-        _status_map[temp_con1].setAll(
+                    + scratch.status_map[current].travel_len;
+        scratch.status_map[temp_con1].setAll(
           __Status::open, travel_len, current);
-        _open_heap.push(__OpenTriangle(
-          temp_con1, dest_dist(tri.center_x, tri.center_y)
-          + travel_len));
+        open_list.push(temp_con1,
+          heuristic(tri.center_x, tri.center_y) + travel_len);
       }
-      if(temp_con2 != -1 
-        && _status_map[temp_con2].status == __Status::unused)
+      if(temp_con2 != -1
+        && scratch.status_map[temp_con2].status == __Status::unused)
       {
         travel_len = tri.dists[(prev_con + 2) % 3]
-                    + _status_map[current].travel_len;
-        _status_map[temp_con2].setAll(
+                    + scratch.status_map[current].travel_len;
+        scratch.status_map[temp_con2].setAll(
           __Status::open, travel_len, current);
-        _open_heap.push(__OpenTriangle(
-          temp_con2, dest_dist(tri.center_x, tri.center_y)
-          + travel_len));
+        open_list.push(temp_con2,
+          heuristic(tri.center_x, tri.center_y) + travel_len);
       }
     }
 
-    while(!_open_heap.empty()) _open_heap.pop();
+    open_list.clear();
 
-    //list path nodes using a funnel algorithm
-    PathNode* current_node = new PathNode(x_dest, y_dest, nullptr);
+    return found;
+  }
 
-    static std::vector<std::pair<int, int>> funnel;
-    __NavMeshTriangle* triangle;
+  template<class H, class D>
+  bool _searchTriangles(__SearchScratch& scratch, int from,
+                        H heuristic, D done, float width = 0.f)
+  {
+    return _searchTrianglesIn(scratch.open_queue, scratch, from,
+                              heuristic, done, width);
+  }
+
+  /*
+    the funnel compares the angle from one side vector to another. these
+    give the sign of std::arg(b / a) from a cross product, collinear
+    vectors count as an angle of 0 or pi by their dot product. a zero a
+    compares false both ways, like the nan of the division did.
+  */
+  inline double _cross(NavMeshVert a, NavMeshVert b)
+  {
+    //products of floats are exact in double, so is the sign
+    return (double)a.first * b.second - (double)a.second * b.first;
+  }
+
+  inline bool _angleNonNegative(NavMeshVert a, NavMeshVert b)
+  {
+    if(a.first == 0.f && a.second == 0.f)
+      return false;
+    return _cross(a, b) >= 0.;
+  }
+
+  inline bool _angleNonPositive(NavMeshVert a, NavMeshVert b)
+  {
+    if(a.first == 0.f && a.second == 0.f)
+      return false;
+    double cross = _cross(a, b);
+    return cross < 0. || (cross == 0. && _dotProduct(a, b) >= 0.);
+  }
+
+  /*
+    funnel algorithm over a list of portals (vertex index pairs) ordered
+    from destination to start, waypoints are written from destination to
+    start. corners are passed at least radius away.
+  */
+  void _stringPull(const std::vector<std::pair<int, int>>& funnel,
+                  float x_start, float y_start, float x_dest, float y_dest,
+                  std::vector<NavMeshVert>& path, float radius = 0.f)
+  {
+    NavMeshVert apex(x_dest, y_dest);
+    NavMeshVert l_side, r_side;
+    int l_break = 0;
+    int r_break = 0;
+
+    //a corner is turned at once at most. turning at the same one again
+    //leaves the apex where it is and would repeat forever, which happens
+    //when the start is not behind the first portal
+    int last_turn = -1;
+    unsigned turns = 0;
+    bool stuck = false;
+
+    //moves the apex to a corner of portal, offset towards the other end of
+    //the portal to keep clear of the obstacle
+    auto turn = [&](int portal, bool left)
+    {
+      int corner_turn = portal * 2 + (left? 1 : 0);
+      if(corner_turn == last_turn || ++turns > funnel.size() * 2)
+      {
+        stuck = true;
+        return;
+      }
+      last_turn = corner_turn;
+
+      const NavMeshVert& corner = _navmesh_verts[
+        left? funnel[portal].first : funnel[portal].second];
+      const NavMeshVert& other = _navmesh_verts[
+        left? funnel[portal].second : funnel[portal].first];
+
+      float tempf = (std::fabs(corner.first - other.first)
+                  + std::fabs(corner.second - other.second)) * 4;
+      if(radius > 0.f)
+        tempf = std::min(tempf, (float)_distance(corner, other) / radius);
+      //stay on the near half of short portals, tile borders make
+      //them end in free space
+      tempf = std::max(tempf, 2.f);
+      apex.first = corner.first + (other.first - corner.first) / tempf;
+      apex.second = corner.second + (other.second - corner.second) / tempf;
+
+      if(left)
+      {
+        l_side = corner - apex;
+        r_side = NavMeshVert(-l_side.first, -l_side.second);
+      }
+      else
+      {
+        r_side = corner - apex;
+        l_side = NavMeshVert(-r_side.first, -r_side.second);
+      }
+      path.push_back(apex);
+    };
+
+    path.push_back(apex);
+    l_side = _navmesh_verts[funnel[0].first] - apex;
+    r_side = _navmesh_verts[funnel[0].second] - apex;
+    unsigned current = 1;
 
-    //insert vertex index pairs into funnel
-    funnel.clear();
     do
     {
-      triangle = &_navmesh_triangles[current];
-      current = _status_map[current].prev;
-      int con = triangle->getCon(current);
-      funnel.push_back({triangle->indices[con],
-        triangle->indices[(con + 1) % 3]});
-    }while(current != from);
+      for(; current < funnel.size() && !stuck; ++current)
+      {
+        if(funnel[current].first == funnel[current - 1].first)
+        //turn left
+        {
+          NavMeshVert next = _navmesh_verts[funnel[current].second] - apex;
+          if(_angleNonNegative(l_side, next)) //break on left
+          {
+            current = r_break = l_break;
+            turn(current, true);
+          }
+          else if(_angleNonNegative(r_side, next))
+          {
+            r_side = next;
+            r_break = current;
+            if(l_break + 1 == (int)current) l_break = current;
+          }
+        }
+        else //turn right
+        {
+          NavMeshVert next = _navmesh_verts[funnel[current].first] - apex;
+          if(_angleNonPositive(r_side, next)) //break on right
+          {
+            current = l_break = r_break;
+            turn(current, false);
+          }
+          else if(_angleNonPositive(l_side, next))
+          {
+            l_side = next;
+            l_break = current;
+            if(r_break + 1 == (int)current) r_break = current;
+          }
+        }
+      }
+
+      //final condition
+      NavMeshVert next(x_start - apex.first, y_start - apex.second);
+      if(!stuck && _angleNonNegative(l_side, next)) //break left
+      {
+        current = r_break = l_break;
+        turn(current, true);
+        ++current;
+      }
+      else if(!stuck && _angleNonPositive(r_side, next)) //break right
+      {
+        current = l_break = r_break;
+        turn(current, false);
+        ++current;
+      }
+      else
+      {
+        path.push_back(apex);
+        break;
+      }
+
+    }while(true);
+  }
+
+#ifdef WORLD_GEO_BENCH
+  /*
+    the funnel before the cross product version, for comparisons. carries
+    the radius offset and the repeated turn cutoff of the current one, the
+    side tests still go through std::arg.
+  */
+  void _stringPullAngles(const std::vector<std::pair<int, int>>& funnel,
+                  float x_start, float y_start, float x_dest, float y_dest,
+                  std::vector<NavMeshVert>& path, float radius = 0.f)
+  {
+    int current;
+
+    path.push_back(NavMeshVert(x_dest, y_dest));
 
     std::complex<double> l_angle, r_angle, t_angle;
     float current_x, current_y;
-    int l_break, r_break, l_vert, r_vert;
+    int l_break, r_break;
+
+    int last_turn = -1;
+    unsigned turns = 0;
+    bool stuck = false;
+
+    auto turn = [&](int portal, bool left)
+    {
+      int corner_turn = portal * 2 + (left? 1 : 0);
+      if(corner_turn == last_turn || ++turns > funnel.size() * 2)
+      {
+        stuck = true;
+        return;
+      }
+      last_turn = corner_turn;
+
+      int vert = left? funnel.at(portal).first : funnel.at(portal).second;
+      int other = left? funnel.at(portal).second : funnel.at(portal).first;
+
+      current_x = _navmesh_verts[vert].first;
+      current_y = _navmesh_verts[vert].second;
+      float tempf =
+      (std::fabs(current_x - _navmesh_verts[other].first) +
+      std::fabs(current_y - _navmesh_verts[other].second)) * 4;
+      if(radius > 0.f)
+        tempf = std::min(tempf, (float)_distance(_navmesh_verts[vert],
+                                                _navmesh_verts[other]) / radius);
+      //stay on the near half of short portals, tile borders make
+      //them end in free space
+      tempf = std::max(tempf, 2.f);
+      current_x += (_navmesh_verts[other].first - current_x) / tempf;
+      current_y += (_navmesh_verts[other].second - current_y) / tempf;
+
+      if(left)
+      {
+        l_angle = {_navmesh_verts[vert].first - current_x,
+                    _navmesh_verts[vert].second - current_y};
+        r_angle = -l_angle;
+      }
+      else
+      {
+        r_angle = {_navmesh_verts[vert].first - current_x,
+                    _navmesh_verts[vert].second - current_y};
+        l_angle = -r_angle;
+      }
+
+      path.push_back(NavMeshVert(current_x, current_y));
+    };
 
     current_x = x_dest;
     current_y = y_dest;
 
     l_break = r_break = current = 0;
-    l_vert = funnel.at(0).first;
-    r_vert = funnel.at(0).second;
 
-    l_angle = {_navmesh_verts[l_vert].first - current_x,
-                _navmesh_verts[l_vert].second - current_y};
-    r_angle = {_navmesh_verts[r_vert].first - current_x,
-                _navmesh_verts[r_vert].second - current_y};
+    l_angle = {_navmesh_verts[funnel.at(0).first].first - current_x,
+                _navmesh_verts[funnel.at(0).first].second - current_y};
+    r_angle = {_navmesh_verts[funnel.at(0).second].first - current_x,
+                _navmesh_verts[funnel.at(0).second].second - current_y};
 
     ++current;
 
     do
     {
-      while((unsigned)current < funnel.size())
+      while((unsigned)current < funnel.size() && !stuck)
       {
         if(funnel.at(current).first == funnel.at(current - 1).first)
         //turn left
@@ -1898,27 +2736,7 @@ namespace WorldGeo
           if(std::arg(t_angle / l_angle) >= 0.) //break on left
           {
             current = r_break = l_break;
-            l_vert = funnel.at(current).first;
-            r_vert = funnel.at(current).second;
-
-            current_x = _navmesh_verts[l_vert].first;
-            current_y = _navmesh_verts[l_vert].second;
-            float tempf =
-            (std::fabs(current_x
-                    - _navmesh_verts[r_vert].first) +
-            std::fabs(current_y
-                    - _navmesh_verts[r_vert].second)) * 4;
-            current_x +=
-            (_navmesh_verts[r_vert].first - current_x) / tempf;
-            current_y +=
-            (_navmesh_verts[r_vert].second - current_y) / tempf;
-
-            l_angle = {_navmesh_verts[l_vert].first - current_x,
-                        _navmesh_verts[l_vert].second - current_y};
-            r_angle = -l_angle;
-
-            current_node =
-            new PathNode(current_x, current_y, current_node);
+            turn(current, true);
           }
           else if(std::arg(t_angle / r_angle) >= 0.)
           {
@@ -1938,27 +2756,7 @@ namespace WorldGeo
           if(std::arg(t_angle / r_angle) <= 0.) //break on right
           {
             current = l_break = r_break;
-            l_vert = funnel.at(current).first;
-            r_vert = funnel.at(current).second;
-
-            current_x = _navmesh_verts[r_vert].first;
-            current_y = _navmesh_verts[r_vert].second;
-            float tempf =
-            (std::fabs(current_x
-                        - _navmesh_verts[l_vert].first) +
-            std::fabs(current_y
-                        - _navmesh_verts[l_vert].second)) * 4;
-            current_x +=
-            (_navmesh_verts[l_vert].first - current_x) / tempf;
-            current_y +=
-            (_navmesh_verts[l_vert].second - current_y) / tempf;
-
-            r_angle = {_navmesh_verts[r_vert].first - current_x,
-                        _navmesh_verts[r_vert].second - current_y};
-            l_angle = -r_angle;
-
-            current_node =
-            new PathNode(current_x, current_y, current_node);
+            turn(current, false);
           }
           else if(std::arg(t_angle / l_angle) <= 0.)
           {
@@ -1973,193 +2771,2199 @@ namespace WorldGeo
 
       //final condition
       t_angle = {x_start - current_x, y_start - current_y};
-      if(std::arg(t_angle / l_angle) >= 0.) //break left
+      if(!stuck && std::arg(t_angle / l_angle) >= 0.) //break left
       {
         current = r_break = l_break;
-        l_vert = funnel.at(current).first;
-        r_vert = funnel.at(current).second;
-
-        current_x = _navmesh_verts[l_vert].first;
-        current_y = _navmesh_verts[l_vert].second;
-        float tempf =
-        (std::fabs(current_x - _navmesh_verts[r_vert].first) +
-        std::fabs(current_y - _navmesh_verts[r_vert].second)) * 4;
-        current_x += 
-            (_navmesh_verts[r_vert].first - current_x) / tempf;
-        current_y +=
-            (_navmesh_verts[r_vert].second - current_y) / tempf;
-
-        l_angle = {_navmesh_verts[l_vert].first - current_x,
-                    _navmesh_verts[l_vert].second - current_y};
-        r_angle = -l_angle;
-
-        current_node = new PathNode(current_x, current_y, current_node);
+        turn(current, true);
         ++current;
       }
-      else if(std::arg(t_angle / r_angle) <= 0.) //break right
+      else if(!stuck && std::arg(t_angle / r_angle) <= 0.) //break right
       {
         current = l_break = r_break;
-        l_vert = funnel.at(current).first;
-        r_vert = funnel.at(current).second;
-
-        current_x = _navmesh_verts[r_vert].first;
-        current_y = _navmesh_verts[r_vert].second;
-        float tempf =
-        (std::fabs(current_x - _navmesh_verts[l_vert].first) +
-        std::fabs(current_y - _navmesh_verts[l_vert].second)) * 4;
-        current_x +=
-        (_navmesh_verts[l_vert].first - current_x) / tempf;
-        current_y +=
-        (_navmesh_verts[l_vert].second - current_y) / tempf;
-
-        r_angle = {_navmesh_verts[r_vert].first - current_x,
-                    _navmesh_verts[r_vert].second - current_y};
-        l_angle = -r_angle;
-
-        current_node = new PathNode(current_x, current_y, current_node);
+        turn(current, false);
         ++current;
       }
       else
       {
-        current_node = new PathNode(current_x, current_y, current_node);
+        path.push_back(NavMeshVert(current_x, current_y));
         break;
       }
 
     }while(true);
-
-    return current_node;
-  }
-  
-  //collision detection
-  bool isBlocked(float x, float y)
-  {
-    if(!_nav_mesh_triangle_tree_inited) return false;
-    return _nav_mesh_triangle_tree.retrieve(x, y) == -1;
   }
-  
-  void pushIn(float& x, float& y, float last_x, float last_y)
+
+#endif
+
+  ///hierarchical pathfinding
+  /*
+    triangles are grouped into clusters by plate and a square grid.
+    triangles with a connection into another cluster are gates, they form
+    an abstract graph with the shortest in-cluster travel lengths between
+    the gates of one cluster and the crossings between neighbouring gates.
+    long queries search this graph and follow precomputed in-cluster routes
+    from gate to gate, only the start and destination clusters are searched
+    triangle by triangle.
+  */
+  constexpr float __cluster_size = 8.;
+  constexpr float __hierarchy_min_range = __cluster_size * 2;
+  /*
+    travel lengths between triangle centers run well above the straight
+    line distance, the heuristic is weighted to keep the gate search narrow
+  */
+  constexpr int __hierarchy_greed = 2;
+
+  std::vector<int> _cluster_of;           //cluster of each triangle
+  std::vector<int> _cluster_local;        //index of each triangle in its cluster
+  std::vector<int> _cluster_tri_ofsets;
+  std::vector<int> _cluster_tris;
+  std::vector<int> _cluster_gate_ofsets;
+  std::vector<int> _gate_tris;
+  std::vector<int> _gate_edge_ofsets;
+  std::vector<std::pair<int, int>> _gate_edges;   //gate, travel length
+  /*
+    for every gate and every triangle of its cluster, the connection to
+    take towards the gate, -1 if the gate can not be reached in-cluster
+  */
+  std::vector<int> _gate_route_ofsets;
+  std::vector<int8_t> _gate_routes;
+
+  inline int _centerDist(int a, int b)
   {
-    __SquaredDistFunctor<decltype(NavMeshVert::first)> dist_func(x, y);
-  
-    int tri_i = _nav_mesh_triangle_tree.retrieve(last_x, last_y);
+    float x = _navmesh_triangles[a].center_x - _navmesh_triangles[b].center_x;
+    float y = _navmesh_triangles[a].center_y - _navmesh_triangles[b].center_y;
+    return sqrt(x * x + y * y) * __pts_per_unit;
+  }
+
+  //dijkstra over the cluster of start, prev links point towards start
+  void _searchCluster(Utils::CFHeap<int>& heap, __StatusMap& map, int start)
+  {
+    int cluster = _cluster_of[start];
+
+    map.nextGeneration();
+    map[start].setAll(__Status::open, 0, -1);
+    heap.push(start, 0);
+
+    while(!heap.empty())
+    {
+      int current = heap.top();
+      heap.pop();
+
+      auto& entry = map[current];
+      entry.status = __Status::closed;
+
+      for(int con: _navmesh_triangles[current].cons)
+      {
+        if(con == -1 || _cluster_of[con] != cluster)
+          continue;
+
+        int travel_len = entry.travel_len + _centerDist(current, con);
+        auto& next = map[con];
+        if(next.status == __Status::unused ||
+          (next.status == __Status::open && travel_len < next.travel_len))
+        {
+          next.setAll(__Status::open, travel_len, current);
+          heap.update(con, travel_len);
+        }
+      }
+    }
+  }
+
+  void _clearHierarchy()
+  {
+    _cluster_of.clear();
+    _cluster_local.clear();
+    _cluster_tri_ofsets.clear();
+    _cluster_tris.clear();
+    _cluster_gate_ofsets.clear();
+    _gate_tris.clear();
+    _gate_edge_ofsets.clear();
+    _gate_edges.clear();
+    _gate_route_ofsets.clear();
+    _gate_routes.clear();
+  }
+
+  void _buildHierarchy()
+  {
+    int tri_n = _navmesh_triangles.size();
+    int cells_w = (int)(_mapsize_w / 8 / __cluster_size) + 1;
+    int cells_h = (int)(_mapsize_h / 8 / __cluster_size) + 1;
+
+    _clearHierarchy();
+
+    //assign clusters, ids of earlier plates are below first
+    std::vector<int> cell_clusters(cells_w * cells_h, -1);
+    int clusters = 0;
+    _cluster_of.resize(tri_n);
+    for(int plate = 0; plate < _num_plates; ++plate)
+    {
+      int first = clusters;
+      for(int tri = _plate_ofsets[plate]; tri < _plate_ofsets[plate + 1]; ++tri)
+      {
+        int cell = (int)(_navmesh_triangles[tri].center_x / __cluster_size)
+          + (int)(_navmesh_triangles[tri].center_y / __cluster_size) * cells_w;
+        if(cell_clusters[cell] < first)
+          cell_clusters[cell] = clusters++;
+        _cluster_of[tri] = cell_clusters[cell];
+      }
+    }
+
+    //list triangles by cluster
+    _cluster_tri_ofsets.assign(clusters + 1, 0);
+    for(int tri = 0; tri < tri_n; ++tri)
+      ++_cluster_tri_ofsets[_cluster_of[tri] + 1];
+    for(int c = 0; c < clusters; ++c)
+      _cluster_tri_ofsets[c + 1] += _cluster_tri_ofsets[c];
+    _cluster_tris.resize(tri_n);
+    _cluster_local.resize(tri_n);
+    {
+      std::vector<int> fill(_cluster_tri_ofsets.begin(),
+                            _cluster_tri_ofsets.end() - 1);
+      for(int tri = 0; tri < tri_n; ++tri)
+      {
+        int c = _cluster_of[tri];
+        _cluster_local[tri] = fill[c] - _cluster_tri_ofsets[c];
+        _cluster_tris[fill[c]++] = tri;
+      }
+    }
+
+    //find gates
+    std::vector<int> gate_of(tri_n, -1);
+    _cluster_gate_ofsets.push_back(0);
+    for(int c = 0; c < clusters; ++c)
+    {
+      for(int n = _cluster_tri_ofsets[c]; n < _cluster_tri_ofsets[c + 1]; ++n)
+      {
+        int tri = _cluster_tris[n];
+        for(int con: _navmesh_triangles[tri].cons)
+        {
+          if(con != -1 && _cluster_of[con] != c)
+          {
+            gate_of[tri] = _gate_tris.size();
+            _gate_tris.push_back(tri);
+            break;
+          }
+        }
+      }
+      _cluster_gate_ofsets.push_back(_gate_tris.size());
+    }
+
+    //connect gates and store the in-cluster routes
+    __StatusMap map;
+    Utils::CFHeap<int> heap;
+    map.create(tri_n);
+    heap.reserve(tri_n);
+    for(int c = 0; c < clusters; ++c)
+    {
+      int gates_begin = _cluster_gate_ofsets[c];
+      int gates_end = _cluster_gate_ofsets[c + 1];
+      for(int gate = gates_begin; gate < gates_end; ++gate)
+      {
+        int gate_tri = _gate_tris[gate];
+        _searchCluster(heap, map, gate_tri);
+
+        _gate_edge_ofsets.push_back(_gate_edges.size());
+        for(int other = gates_begin; other < gates_end; ++other)
+        {
+          auto& entry = map[_gate_tris[other]];
+          if(other != gate && entry.status == __Status::closed)
+            _gate_edges.push_back({other, entry.travel_len});
+        }
+        for(int con: _navmesh_triangles[gate_tri].cons)
+        {
+          if(con != -1 && _cluster_of[con] != c)
+            _gate_edges.push_back({gate_of[con], _centerDist(gate_tri, con)});
+        }
+
+        _gate_route_ofsets.push_back(_gate_routes.size());
+        for(int n = _cluster_tri_ofsets[c]; n < _cluster_tri_ofsets[c + 1]; ++n)
+        {
+          int tri = _cluster_tris[n];
+          auto& entry = map[tri];
+          if(entry.status == __Status::closed && entry.prev != -1)
+            _gate_routes.push_back(_navmesh_triangles[tri].getCon(entry.prev));
+          else _gate_routes.push_back(-1);
+        }
+      }
+    }
+    _gate_edge_ofsets.push_back(_gate_edges.size());
+  }
+
+  /*
+    searches the gate graph from the gates reachable in the start cluster to
+    the gates of the destination cluster, then lists the triangles from
+    from to to in scratch.corridor. returns false if there is no route.
+  */
+  bool _findCorridor(__SearchScratch& scratch, int from, int to,
+                    float x_dest, float y_dest)
+  {
+    auto& heap = scratch.open_heap;
+    auto& gate_map = scratch.gate_map;
+    int from_cluster = _cluster_of[from];
+    int to_cluster = _cluster_of[to];
+    int goal = _gate_tris.size();
+
+    auto dest_dist = [x_dest, y_dest](int gate)
+    {
+      auto& tri = _navmesh_triangles[_gate_tris[gate]];
+      float x = tri.center_x - x_dest;
+      float y = tri.center_y - y_dest;
+      return (int)(sqrt(x * x + y * y) * __pts_per_unit);
+    };
+    auto relax = [&](int gate, int travel_len, int prev)
+    {
+      auto& entry = gate_map[gate];
+      if(entry.status == __Status::unused ||
+        (entry.status == __Status::open && travel_len < entry.travel_len))
+      {
+        entry.setAll(__Status::open, travel_len, prev);
+        heap.update(gate,
+          travel_len + (gate == goal? 0 : dest_dist(gate) * __hierarchy_greed));
+      }
+    };
+
+    _searchCluster(heap, scratch.from_map, from);
+    _searchCluster(heap, scratch.to_map, to);
+
+    gate_map.nextGeneration();
+    for(int gate = _cluster_gate_ofsets[from_cluster];
+        gate < _cluster_gate_ofsets[from_cluster + 1]; ++gate)
+    {
+      auto& start = scratch.from_map[_gate_tris[gate]];
+      if(start.status == __Status::closed)
+        relax(gate, start.travel_len, -1);
+    }
+
+    bool found = false;
+    while(!heap.empty())
+    {
+      int current = heap.top();
+      heap.pop();
+      if(current == goal)
+      {
+        found = true;
+        break;
+      }
+
+      auto& entry = gate_map[current];
+      entry.status = __Status::closed;
+
+      int tri = _gate_tris[current];
+      if(_cluster_of[tri] == to_cluster)
+      {
+        auto& end = scratch.to_map[tri];
+        if(end.status == __Status::closed)
+          relax(goal, entry.travel_len + end.travel_len, current);
+      }
+      for(int e = _gate_edge_ofsets[current];
+          e < _gate_edge_ofsets[current + 1]; ++e)
+        relax(_gate_edges[e].first,
+              entry.travel_len + _gate_edges[e].second, current);
+    }
+    heap.clear();
+
+    if(!found)
+      return false;
+
+    //gates from destination back to start
+    auto& gates = scratch.gates;
+    gates.clear();
+    for(int gate = gate_map[goal].prev; gate != -1; gate = gate_map[gate].prev)
+      gates.push_back(gate);
+
+    //triangles are marked in the status map while they are in the corridor
+    auto& corridor = scratch.corridor;
+    corridor.clear();
+    scratch.status_map.nextGeneration();
+    auto append = [&](int tri)
+    {
+      auto& entry = scratch.status_map[tri];
+      if(entry.status == __Status::closed)
+      {
+        //the route runs into itself, cut the loop
+        while(corridor.back() != tri)
+        {
+          scratch.status_map[corridor.back()].status = __Status::unused;
+          corridor.pop_back();
+        }
+        return;
+      }
+      entry.status = __Status::closed;
+      corridor.push_back(tri);
+    };
+
+    auto& segment = scratch.segment;
+    segment.clear();
+    for(int tri = _gate_tris[gates.back()]; tri != -1;
+        tri = scratch.from_map[tri].prev)
+      segment.push_back(tri);
+    for(auto it = segment.rbegin(); it != segment.rend(); ++it)
+      append(*it);
+
+    for(unsigned n = gates.size() - 1; n != 0; --n)
+    {
+      int tri = _gate_tris[gates[n]];
+      int next = gates[n - 1];
+      int next_tri = _gate_tris[next];
+      if(_cluster_of[tri] != _cluster_of[next_tri])
+      {
+        append(next_tri);
+        continue;
+      }
+      const int8_t* route = &_gate_routes[_gate_route_ofsets[next]];
+      while(tri != next_tri)
+      {
+        tri = _navmesh_triangles[tri].cons[route[_cluster_local[tri]]];
+        append(tri);
+      }
+    }
+
+    for(int tri = scratch.to_map[_gate_tris[gates.front()]].prev; tri != -1;
+        tri = scratch.to_map[tri].prev)
+      append(tri);
+
+    return true;
+  }
+
+  //whether a unit of width can pass tri from prev to next, which fails
+  //for dead triangles and for neighbours unlinked by carving
+  bool _passable(int tri, int prev, int next, float width)
+  {
+    auto& triangle = _navmesh_triangles[tri];
+    int a = triangle.getCon(prev);
+    int b = triangle.getCon(next);
+    return a != -1 && b != -1 && triangle.crossing(a, b) >= width;
+  }
+
+  /*
+    replaces the crossings of scratch.corridor narrower than width, or
+    through dead triangles, with detours searched for width. a detour runs
+    from the triangle before the crossing to the first later corridor
+    triangle it can leave the way the corridor goes on. returns false if
+    some crossing has no detour.
+  */
+  bool _widenCorridor(__SearchScratch& scratch, float width)
+  {
+    auto& corridor = scratch.corridor;
+    unsigned last = corridor.size() - 1;
+
+    //corridor positions, the gate search is done with from_map
+    auto& position = scratch.from_map;
+    position.nextGeneration();
+    for(unsigned n = 0; n <= last; ++n)
+      position[corridor[n]].setAll(__Status::closed, n, -1);
+
+    //detours may run back over the widened corridor, such loops are cut
+    auto& widened = scratch.segment;
+    auto& in_widened = scratch.to_map;
+    widened.clear();
+    in_widened.nextGeneration();
+    auto append = [&](int tri)
+    {
+      auto& entry = in_widened[tri];
+      if(entry.status == __Status::closed)
+      {
+        while(widened.back() != tri)
+        {
+          in_widened[widened.back()].status = __Status::unused;
+          widened.pop_back();
+        }
+        return;
+      }
+      entry.status = __Status::closed;
+      widened.push_back(tri);
+    };
+
+    append(corridor[0]);
+    unsigned n = 1;
+    while(n < last)
+    {
+      if(_passable(corridor[n], widened.back(), corridor[n + 1], width))
+      {
+        append(corridor[n++]);
+        continue;
+      }
+
+      auto& target = _navmesh_triangles[corridor[n + 1]];
+      float x_target = target.center_x;
+      float y_target = target.center_y;
+      auto target_dist = [x_target, y_target](float x, float y)
+      {
+        x -= x_target;
+        y -= y_target;
+        return sqrt(x * x + y * y) * __pts_per_unit;
+      };
+      int end = -1;
+      auto rejoined = [&](int current)
+      {
+        auto& entry = position[current];
+        if(entry.status != __Status::closed || entry.travel_len <= (int)n)
+          return false;
+        unsigned at = entry.travel_len;
+        if(at < last && !_passable(current, scratch.status_map[current].prev,
+                                   corridor[at + 1], width))
+          return false;
+        end = current;
+        return true;
+      };
+
+      int start = widened.back();
+      if(!_searchTriangles(scratch, start, target_dist, rejoined, width))
+        return false;
+
+      unsigned ofset = scratch.gates.size();
+      for(int tri = end; tri != start; tri = scratch.status_map[tri].prev)
+        scratch.gates.push_back(tri);
+      for(unsigned k = scratch.gates.size(); k != ofset; --k)
+        append(scratch.gates[k - 1]);
+      scratch.gates.resize(ofset);
+      n = position[end].travel_len + 1;
+    }
+    if(n == last)
+      append(corridor[last]);
+
+    corridor.swap(widened);
+    return true;
+  }
+
+  /*
+    the following code implements the A* algorithm
+    the path is written to path in order from destination to start.
+    with a radius, only crossings wide enough for the unit are used, unless
+    there is no such route at all.
+  */
+
+  bool _findPath(__SearchScratch& scratch,
+                float x_start, float y_start, float x_dest, float y_dest,
+                std::vector<NavMeshVert>& path, float radius = 0.f)
+  {
+    /*
+      paths between cluster gates are precalculated in the cluster graph,
+      missed destinations are snapped through the outline edge index.
+      possible optimizations:
+        triangles along plate edges can be precalculated
+    */
     
+    auto dest_dist = [x_dest, y_dest](float x, float y)
+    {
+      x -= x_dest;
+      y -= y_dest;
+      return sqrt(x * x + y * y) * __pts_per_unit;
+    };
+
+    path.clear();
+
+    if(_locator_buckets.empty())
+      return false;
+
+    int from = 0;
+    int to = 0;
+
+    if((from = _locateTriangle(x_start, y_start)) == -1)
+    {
 #ifndef NDEBUG
-    if(tri_i == -1)
+      printf("findPath: start point not found in the navmesh.\n"
+            "%s: %i\n", __FILE__, __LINE__);
+#endif
+      return false;
+    }
+    to = _locateDestination(_getComponent(from), x_dest, y_dest);
+    if(to == -1)
+      return false;
+
+    if(from == to)
     {
-      printf("invalid last coordinates in WorldGeo::pushIn\n%s: %i\n",
-              __FILE__, __LINE__);
-      return;
+      path.push_back(NavMeshVert(x_dest, y_dest));
+      return true;
     }
-#endif
 
-    //triangle bounds
-    __NavMeshTriangle& tri = _navmesh_triangles[tri_i];
-    NavMeshVert v1 = _navmesh_verts[tri.indices[0]];
-    NavMeshVert v2 = _navmesh_verts[tri.indices[1]];
-    NavMeshVert v3 = _navmesh_verts[tri.indices[2]];
-    
-    //biasing (this could prevent chraches)
-    /*constexpr double bias = 10.;
-    v1.first += (tri.center_x - v1.first) / bias;
-    v1.second += (tri.center_y - v1.second) / bias;
-    v2.first += (tri.center_x - v2.first) / bias;
-    v2.second += (tri.center_y - v2.second) / bias;
-    v3.first += (tri.center_x - v3.first) / bias;
-    v3.second += (tri.center_y - v3.second) / bias;*/
-    
-    NavMeshVert point = {x, y};
-    int corner = 0;
-    double dist_sq, ratio;
-    
+    auto& funnel = scratch.funnel;
+    funnel.clear();
+
+    /*
+      long queries run over the cluster graph, which does not know unit
+      sizes or carved tiles, so narrow crossings and dead triangles of the
+      corridor are detoured around. triangles of carved tiles are in no
+      cluster.
+    */
+    if(!_cluster_of.empty() && _cluster_of[from] != _cluster_of[to]
+      && _cluster_of[from] != -1 && _cluster_of[to] != -1
+      && dest_dist(x_start, y_start)
+        > __hierarchy_min_range * __pts_per_unit
+      && _findCorridor(scratch, from, to, x_dest, y_dest)
+      && ((radius <= 0.f && _dead_triangles == 0)
+        || _widenCorridor(scratch, radius * 2)))
+    {
+      auto& corridor = scratch.corridor;
+      for(unsigned n = corridor.size() - 1; n != 0; --n)
+      {
+        auto& triangle = _navmesh_triangles[corridor[n]];
+        int con = triangle.getCon(corridor[n - 1]);
+        funnel.push_back({triangle.indices[con],
+          triangle.indices[(con + 1) % 3]});
+      }
+
+      _stringPull(funnel, x_start, y_start, x_dest, y_dest, path, radius);
+      return true;
+    }
+
+    auto reached = [to](int current){return current == to;};
+    if(!(radius > 0.f
+        && _searchTriangles(scratch, from, dest_dist, reached, radius * 2))
+      && !_searchTriangles(scratch, from, dest_dist, reached))
+      return false;
+
+    //list path nodes using a funnel algorithm
+    __NavMeshTriangle* triangle;
+    int current = to;
+
+    //insert vertex index pairs into funnel
     do
     {
-      if(_dotProduct(v2 - v1, _turn90d(point - v1)) > 0.)
+      triangle = &_navmesh_triangles[current];
+      current = scratch.status_map[current].prev;
+      int con = triangle->getCon(current);
+      funnel.push_back({triangle->indices[con],
+        triangle->indices[(con + 1) % 3]});
+    }while(current != from);
+
+    _stringPull(funnel, x_start, y_start, x_dest, y_dest, path, radius);
+
+    return true;
+  }
+  
+
+  //stores a destination to start waypoint list in walking order
+  WorldGeo::PathHandle _storePath(const std::vector<NavMeshVert>& path)
+  {
+    int size_class = 0;
+    while((2u << size_class) < path.size())
+      ++size_class;
+    assert(size_class < __path_size_classes);
+
+    __PathSpan span;
+    span.length = path.size();
+    span.size_class = size_class;
+    auto& free_spans = _free_path_spans[size_class];
+    if(free_spans.empty())
+    {
+      span.ofset = _path_points.size();
+      _path_points.resize(span.ofset + (2u << size_class));
+    }
+    else
+    {
+      span.ofset = free_spans.back();
+      free_spans.pop_back();
+    }
+
+    PathPoint* points = &_path_points[span.ofset];
+    for(unsigned n = 0; n < span.length; ++n)
+      points[n] = {path[span.length - 1 - n].first,
+                   path[span.length - 1 - n].second};
+
+    if(_free_path_handles.empty())
+    {
+      _path_spans.push_back(span);
+      return _path_spans.size();
+    }
+    WorldGeo::PathHandle handle = _free_path_handles.back();
+    _free_path_handles.pop_back();
+    _path_spans[handle - 1] = span;
+    return handle;
+  }
+
+  void _runPathRequest(__PathRequest* request, unsigned worker)
+  {
+    if(!request->cancelled && !_path_requests_held)
+      request->found = _findPath(_worker_scratch[worker],
+        request->x_start, request->y_start,
+        request->x_dest, request->y_dest, request->path, request->radius);
+
+    std::lock_guard<std::mutex> lock(_path_mutex);
+    request->done = true;
+    _path_done_cond.notify_all();
+  }
+
+  void _waitForPathRequest(__PathRequest* request)
+  {
+    std::unique_lock<std::mutex> lock(_path_mutex);
+    _path_done_cond.wait(lock, [request]{return request->done;});
+  }
+
+  //drops all requests, for when the navmesh is deleted
+  void _flushPathRequests()
+  {
+    for(auto& request: _path_requests)
+      request->cancelled = true;
+    for(auto& request: _path_requests)
+      _waitForPathRequest(request.get());
+    _path_requests.clear();
+  }
+
+  /*
+    waits for the running searches, has to be called before the navmesh
+    changes. the requests stay queued and _resumePathRequests searches them
+    again on the changed navmesh, results found before are dropped as they
+    may cross it. they are delivered on the same tick as they would have
+    been.
+  */
+  void _holdPathRequests()
+  {
+    _path_requests_held = true;
+    for(auto& request: _path_requests)
+      _waitForPathRequest(request.get());
+  }
+
+  void _resumePathRequests()
+  {
+    _path_requests_held = false;
+    for(auto& request: _path_requests)
+    {
+      if(request->cancelled)
+        continue;
+      __PathRequest* held = request.get();
+      held->done = false;
+      held->found = false;
+      held->path.clear();
+      _path_workers->submit([held](unsigned worker)
+                            {_runPathRequest(held, worker);});
+    }
+  }
+
+  //sizes the search state for the current navmesh
+  void _initSearchScratch(__SearchScratch& scratch)
+  {
+    scratch.status_map.create(_navmesh_triangles.size());
+    scratch.from_map.create(_navmesh_triangles.size());
+    scratch.to_map.create(_navmesh_triangles.size());
+    scratch.gate_map.create(_gate_tris.size() + 1);
+    scratch.open_heap.reserve(_navmesh_triangles.size() + 1);
+  }
+
+  void _resetSearchScratch()
+  {
+    _initSearchScratch(_main_scratch);
+    if(_path_workers)
+    {
+      for(unsigned n = 0; n < _path_workers->size(); ++n)
+        _initSearchScratch(_worker_scratch[n]);
+    }
+  }
+
+  //after carving appended triangles, the gate graph is unchanged
+  void _growSearchScratch()
+  {
+    auto grow = [](__SearchScratch& scratch)
+    {
+      scratch.status_map.reserve(_navmesh_triangles.size());
+      scratch.from_map.reserve(_navmesh_triangles.size());
+      scratch.to_map.reserve(_navmesh_triangles.size());
+      scratch.open_heap.reserve(_navmesh_triangles.size() + 1);
+    };
+    grow(_main_scratch);
+    if(_path_workers)
+    {
+      for(unsigned n = 0; n < _path_workers->size(); ++n)
+        grow(_worker_scratch[n]);
+    }
+  }
+
+  void _startPathWorkers()
+  {
+    if(_path_workers)
+      return;
+    _path_workers.reset(new Utils::ThreadPool);
+    _worker_scratch.reset(new __SearchScratch[_path_workers->size()]);
+    for(unsigned n = 0; n < _path_workers->size(); ++n)
+      _initSearchScratch(_worker_scratch[n]);
+  }
+
+  ///flow fields
+  /*
+    one dijkstra pass from the goal over the navmesh triangles stores, for
+    every triangle, the connection leading towards the goal. units ordered
+    to the same point share the field and only sample it per tick.
+    with a radius, the pass keeps to crossings wide enough for the units.
+    triangles it leaves unreached get their exits from a second pass
+    without, which leads them onto the wide routes where they meet.
+  */
+  struct __FlowField
+  {
+    float x_start, y_start;     //first unit, picks the component
+    float x_dest, y_dest;       //as ordered
+    float x_goal, y_goal;       //moved onto the navmesh
+    float radius;               //of the largest unit
+    int component;
+    unsigned refs;
+    unsigned generation;        //navmesh the field was computed for
+    std::vector<int8_t> exits;  //connection index, -1 at the goal, -2 unreached
+  };
+
+  //slot n holds field id n + 1
+  std::vector<std::unique_ptr<__FlowField>> _flow_fields;
+  unsigned _navmesh_generation = 0;
+
+  void __computeFlowField(__FlowField& field)
+  {
+    field.generation = _navmesh_generation;
+    field.exits.assign(_navmesh_triangles.size(), -2);
+
+    int from = _locateTriangle(field.x_start, field.y_start);
+    if(from == -1)
+      return;
+    field.x_goal = field.x_dest;
+    field.y_goal = field.y_dest;
+    int goal = _locateDestination(_getComponent(from),
+                                  field.x_goal, field.y_goal);
+    if(goal == -1)
+      return;
+
+    std::vector<float> costs;
+    Utils::CFHeap<float> open_heap;
+    open_heap.reserve(_navmesh_triangles.size());
+
+    //exits are only written where kept has none
+    auto spread = [&](float width, const std::vector<int8_t>* kept)
+    {
+      costs.assign(_navmesh_triangles.size(),
+                   std::numeric_limits<float>::max());
+      costs[goal] = 0.;
+      field.exits[goal] = -1;
+      open_heap.push(goal, 0.);
+
+      while(!open_heap.empty())
+      {
+        int current = open_heap.top();
+        open_heap.pop();
+
+        __NavMeshTriangle& tri = _navmesh_triangles[current];
+        int exit = field.exits[current];
+        for(int k = 0; k < 3; ++k)
+        {
+          int next = tri.cons[k];
+          if(next == -1)
+            continue;
+          //units entering here from next pass on through exit
+          if(width > 0.f && exit != -1 && tri.crossing(k, exit) < width)
+            continue;
+          __NavMeshTriangle& next_tri = _navmesh_triangles[next];
+          float cost = costs[current] + _distance(
+            NavMeshVert(tri.center_x, tri.center_y),
+            NavMeshVert(next_tri.center_x, next_tri.center_y));
+          if(cost >= costs[next])
+            continue;
+
+          costs[next] = cost;
+          if(kept == nullptr || (*kept)[next] == -2)
+          {
+            for(int8_t c = 0; c < 3; ++c)
+            {
+              if(next_tri.cons[c] == current)
+                field.exits[next] = c;
+            }
+          }
+          open_heap.update(next, cost);
+        }
+      }
+    };
+
+    spread(field.radius * 2, nullptr);
+    if(field.radius > 0.f)
+    {
+      std::vector<int8_t> wide = field.exits;
+      spread(0.f, &wide);
+    }
+  }
+}
+
+///
+namespace WorldGeo
+{
+  const PathPoint* getPath(PathHandle handle, unsigned* length)
+  {
+    const __PathSpan& span = _path_spans[handle - 1];
+    *length = span.length;
+    return &_path_points[span.ofset];
+  }
+
+  void freePath(PathHandle handle)
+  {
+    if(handle == 0)
+      return;
+    const __PathSpan& span = _path_spans[handle - 1];
+    _free_path_spans[span.size_class].push_back(span.ofset);
+    _free_path_handles.push_back(handle);
+  }
+
+  PathHandle findPath(float x_start, float y_start, float x_dest, float y_dest)
+  {
+    return findPath(x_start, y_start, x_dest, y_dest, 0.f);
+  }
+
+  PathHandle findPath(float x_start, float y_start, float x_dest, float y_dest,
+                      float radius)
+  {
+    if(!_findPath(_main_scratch, x_start, y_start, x_dest, y_dest,
+                  _main_scratch.path, radius))
+      return 0;
+    return _storePath(_main_scratch.path);
+  }
+
+  /*
+    paths for several units to one destination. one search is run per
+    component, outwards from the destination triangle towards the box
+    around the start triangles until every one of them is reached, so the
+    cost grows with the number of distinct start triangles rather than with
+    the number of units. each unit then walks the search tree towards the
+    destination for its own funnel pass. the search does not use the
+    cluster graph, so a few units are faster to route one by one.
+    with a radius, units the search does not reach through crossings wide
+    enough are searched again without, as in _findPath.
+  */
+  void findGroupPaths(const std::vector<std::pair<float, float>>& starts,
+                      float x_dest, float y_dest, float radius,
+                      std::vector<PathHandle>* paths)
+  {
+    auto& scratch = _main_scratch;
+    auto& funnel = scratch.funnel;
+
+    paths->assign(starts.size(), 0);
+    if(_locator_buckets.empty())
+      return;
+
+    //start triangles, -1 marks units which are done or off the navmesh
+    std::vector<int> froms(starts.size());
+    for(unsigned n = 0; n < starts.size(); ++n)
+      froms[n] = _locateTriangle(starts[n].first, starts[n].second);
+
+    std::vector<int> targets;
+    for(unsigned n = 0; n < starts.size(); ++n)
+    {
+      if(froms[n] == -1)
+        continue;
+
+      int component = _getComponent(froms[n]);
+      float x_group_dest = x_dest;
+      float y_group_dest = y_dest;
+      int to = _locateDestination(component, x_group_dest, y_group_dest);
+
+      //the first pass only runs with a radius
+      for(int pass = radius > 0.f? 0 : 1; pass < 2; ++pass)
+      {
+        float width = pass == 0? radius * 2 : 0.f;
+
+        targets.clear();
+        for(unsigned m = n; m < starts.size(); ++m)
+        {
+          if(froms[m] != -1 && froms[m] != to
+            && _getComponent(froms[m]) == component)
+            targets.push_back(froms[m]);
+        }
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()),
+                      targets.end());
+
+        //the search heads for the box around the start triangles, which no
+        //route to one of them is shorter than
+        float min_x = std::numeric_limits<float>::max(), min_y = min_x;
+        float max_x = -min_x, max_y = -min_x;
+        for(int target: targets)
+        {
+          const auto& triangle = _navmesh_triangles[target];
+          min_x = std::min(min_x, triangle.center_x);
+          min_y = std::min(min_y, triangle.center_y);
+          max_x = std::max(max_x, triangle.center_x);
+          max_y = std::max(max_y, triangle.center_y);
+        }
+        auto box_dist = [min_x, min_y, max_x, max_y](float x, float y)
+        {
+          float x_out = std::max(std::max(min_x - x, x - max_x), 0.f);
+          float y_out = std::max(std::max(min_y - y, y - max_y), 0.f);
+          return sqrt(x_out * x_out + y_out * y_out) * __pts_per_unit;
+        };
+
+        unsigned remaining = targets.size();
+        if(remaining != 0)
+        {
+          _searchTriangles(scratch, to, box_dist,
+            [&](int current)
+            {
+              return std::binary_search(targets.begin(), targets.end(),
+                                        current)
+                    && --remaining == 0;
+            }, width);
+        }
+
+        for(unsigned m = n; m < starts.size(); ++m)
+        {
+          int from = froms[m];
+          if(from == -1 || _getComponent(from) != component)
+            continue;
+
+          //unreached units wait for the second pass, or get no path
+          if(from != to && remaining != 0
+            && scratch.status_map[from].status == __Status::unused)
+          {
+            if(pass == 1)
+              froms[m] = -1;
+            continue;
+          }
+          froms[m] = -1;
+
+          scratch.path.clear();
+          if(from == to)
+          {
+            scratch.path.push_back(NavMeshVert(x_group_dest, y_group_dest));
+            (*paths)[m] = _storePath(scratch.path);
+            continue;
+          }
+
+          //the search ran from the destination, so the portals are listed
+          //from start to destination and reversed for the funnel
+          funnel.clear();
+          int current = from;
+          do
+          {
+            int next = scratch.status_map[current].prev;
+            auto& triangle = _navmesh_triangles[next];
+            int con = triangle.getCon(current);
+            funnel.push_back({triangle.indices[con],
+              triangle.indices[(con + 1) % 3]});
+            current = next;
+          }while(current != to);
+          std::reverse(funnel.begin(), funnel.end());
+
+          _stringPull(funnel, starts[m].first, starts[m].second,
+                      x_group_dest, y_group_dest, scratch.path, radius);
+          (*paths)[m] = _storePath(scratch.path);
+        }
+      }
+    }
+  }
+
+  PathRequestId requestPath(float x_start, float y_start,
+                            float x_dest, float y_dest, void* owner)
+  {
+    return requestPath(x_start, y_start, x_dest, y_dest, 0.f, owner);
+  }
+
+  PathRequestId requestPath(float x_start, float y_start,
+                            float x_dest, float y_dest, float radius,
+                            void* owner)
+  {
+    _startPathWorkers();
+
+    __PathRequest* request = new __PathRequest;
+    request->id = _next_path_request_id;
+    request->tick = _path_tick;
+    request->owner = owner;
+    request->x_start = x_start;
+    request->y_start = y_start;
+    request->x_dest = x_dest;
+    request->y_dest = y_dest;
+    request->radius = radius;
+    request->cancelled = false;
+    request->done = false;
+    request->found = false;
+
+    if(++_next_path_request_id == 0)
+      _next_path_request_id = 1;
+
+    _path_requests.emplace_back(request);
+    _path_workers->submit([request](unsigned worker)
+                          {_runPathRequest(request, worker);});
+
+    return request->id;
+  }
+
+  void cancelPathRequest(PathRequestId id)
+  {
+    if(id == 0)
+      return;
+
+    //ids skip 0 when they wrap, so they are not always consecutive. the
+    //queue only holds the requests of the last few ticks
+    for(auto& request: _path_requests)
+    {
+      if(request->id == id)
+      {
+        request->cancelled = true;
+        return;
+      }
+    }
+  }
+
+  /*
+    hands out finished paths in request order, at most budget per call.
+    requests issued since the last call are held back until the next one.
+    if a search is still running it is waited for, so which tick a path
+    arrives on does not depend on thread timing.
+  */
+  void deliverPaths(unsigned budget, PathReceiver receiver)
+  {
+    while(budget != 0 && !_path_requests.empty())
+    {
+      __PathRequest* request = _path_requests.front().get();
+      if(request->tick == _path_tick)
+        break;
+
+      _waitForPathRequest(request);
+      if(!request->cancelled)
+      {
+        receiver(request->owner,
+                request->found? _storePath(request->path) : 0);
+        --budget;
+      }
+      _path_requests.pop_front();
+    }
+
+    ++_path_tick;
+  }
+
+  FlowFieldId acquireFlowField(float x_start, float y_start,
+                               float x_dest, float y_dest, float radius)
+  {
+    int from = _locateTriangle(x_start, y_start);
+    int component = from == -1? -1 : _getComponent(from);
+
+    //units ordered to the same point on the same component share a field
+    unsigned free_slot = _flow_fields.size();
+    for(unsigned n = 0; n < _flow_fields.size(); ++n)
+    {
+      __FlowField* field = _flow_fields[n].get();
+      if(field == nullptr)
+      {
+        free_slot = std::min(free_slot, n);
+        continue;
+      }
+      if(field->component == component && field->x_dest == x_dest
+        && field->y_dest == y_dest && field->radius == radius
+        && field->generation == _navmesh_generation)
+      {
+        ++field->refs;
+        return n + 1;
+      }
+    }
+
+    __FlowField* field = new __FlowField;
+    field->x_start = x_start;
+    field->y_start = y_start;
+    field->x_dest = x_dest;
+    field->y_dest = y_dest;
+    field->radius = radius;
+    field->component = component;
+    field->refs = 1;
+    __computeFlowField(*field);
+
+    if(free_slot == _flow_fields.size())
+      _flow_fields.emplace_back(field);
+    else
+      _flow_fields[free_slot].reset(field);
+    return free_slot + 1;
+  }
+
+  void releaseFlowField(FlowFieldId id)
+  {
+    if(id == 0)
+      return;
+    if(--_flow_fields[id - 1]->refs == 0)
+      _flow_fields[id - 1].reset();
+  }
+
+  void updateFlowFields()
+  {
+    for(auto& field: _flow_fields)
+    {
+      if(field && field->generation != _navmesh_generation)
+        __computeFlowField(*field);
+    }
+  }
+
+  bool sampleFlowField(FlowFieldId id, float x, float y, int& hint,
+                       float* x_target, float* y_target)
+  {
+    //the distance a unit counts as arrived, portal ends are avoided by
+    //portal_margin or the radius of the field and a unit standing on its portal target steers on to
+    //the next one
+    constexpr float arrival = .1;
+    constexpr float portal_margin = .25;
+    constexpr float on_portal = .01;
+    constexpr int max_hops = 4;
+
+    //only reads, see updateFlowFields
+    const __FlowField& field = *_flow_fields[id - 1];
+    assert(field.generation == _navmesh_generation);
+
+    int tri_i = _walkToTriangle(hint, x, y);
+    if(tri_i == -1 || field.exits[tri_i] == -2)
+      return false;
+    hint = tri_i;
+
+    NavMeshVert point(x, y);
+    if(field.exits[tri_i] == -1)
+    {
+      *x_target = field.x_goal;
+      *y_target = field.y_goal;
+      return std::abs(x - field.x_goal) >= arrival
+          || std::abs(y - field.y_goal) >= arrival;
+    }
+
+    //each target is the closest point of the exit portal, so the step
+    //towards it stays inside the triangle. the next portal is only used
+    //from a point on the shared edge, for the same reason
+    NavMeshVert target = point;
+    for(int hop = 0; hop < max_hops; ++hop)
+    {
+      int exit = field.exits[tri_i];
+      if(exit == -1)
+      {
+        target = {field.x_goal, field.y_goal};
+        break;
+      }
+
+      __NavMeshTriangle& tri = _navmesh_triangles[tri_i];
+      NavMeshVert a = _navmesh_verts[tri.indices[exit]];
+      NavMeshVert b = _navmesh_verts[tri.indices[(exit + 1) % 3]];
+      NavMeshVert edge = b - a;
+      float length = _distance(a, b);
+      float margin = std::min(std::max(portal_margin, field.radius) / length,
+                              .5f);
+      float ratio = _dotProduct(target - a, edge) / (length * length);
+      ratio = std::min(std::max(ratio, margin), 1.f - margin);
+
+      target = a + edge * ratio;
+      tri_i = tri.cons[exit];
+      if(_distance(point, target) >= on_portal)
+        break;
+    }
+
+    *x_target = target.first;
+    *y_target = target.second;
+    return true;
+  }
+
+#ifdef WORLD_GEO_BENCH
+  int compareFunnels(unsigned seed, int queries, float radius,
+                     double* cross_ns, double* angle_ns)
+  {
+    using Clock = std::chrono::steady_clock;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> x_dist(0., _mapsize_w / 8);
+    std::uniform_real_distribution<float> y_dist(0., _mapsize_h / 8);
+    auto free_point = [&](float* x, float* y)
+    {
+      do
+      {
+        *x = x_dist(rng);
+        *y = y_dist(rng);
+      }while(_locateTriangle(*x, *y) == -1);
+    };
+
+    std::vector<NavMeshVert> cross_path, angle_path;
+    int differing = 0;
+    *cross_ns = *angle_ns = 0.;
+    for(int n = 0; n < queries; ++n)
+    {
+      float x, y, x_dest, y_dest;
+      free_point(&x, &y);
+      free_point(&x_dest, &y_dest);
+      //a query inside one triangle returns before the funnel is listed
+      auto& scratch = _main_scratch;
+      scratch.funnel.clear();
+      if(!_findPath(scratch, x, y, x_dest, y_dest, cross_path, radius)
+        || scratch.funnel.empty())
+        continue;
+      //the destination as moved onto the navmesh
+      x_dest = cross_path[0].first;
+      y_dest = cross_path[0].second;
+
+      cross_path.clear();
+      auto start = Clock::now();
+      _stringPull(scratch.funnel, x, y, x_dest, y_dest, cross_path, radius);
+      auto end = Clock::now();
+      *cross_ns += std::chrono::duration<double, std::nano>(end - start).count();
+
+      angle_path.clear();
+      start = Clock::now();
+      _stringPullAngles(scratch.funnel, x, y, x_dest, y_dest, angle_path,
+                        radius);
+      end = Clock::now();
+      *angle_ns += std::chrono::duration<double, std::nano>(end - start).count();
+
+      differing += cross_path != angle_path;
+    }
+    return differing;
+  }
+
+  int compareOpenLists(unsigned seed, int queries,
+                       double* heap_ns, double* queue_ns, double* length_ratio)
+  {
+    using Clock = std::chrono::steady_clock;
+
+    std::mt19937 rng(seed);
+    //both open lists are locals, one inside the scratch is reloaded after
+    //every status map write and would be timed at a disadvantage
+    Utils::CFHeap<int> heap;
+    heap.reserve(_navmesh_triangles.size() + 1);
+    __OpenQueue queue;
+    std::uniform_int_distribution<int> tri_dist(0,
+      _navmesh_triangles.size() - 1);
+    auto& scratch = _main_scratch;
+
+    int searched = 0;
+    *heap_ns = *queue_ns = *length_ratio = 0.;
+    for(int n = 0; n < queries; ++n)
+    {
+      int from, to;
+      do
+      {
+        from = tri_dist(rng);
+        to = tri_dist(rng);
+      }while(from == to || _navmesh_triangles[from].dead()
+        || _getComponent(from) != _getComponent(to));
+
+      float x_dest = _navmesh_triangles[to].center_x;
+      float y_dest = _navmesh_triangles[to].center_y;
+      auto dest_dist = [x_dest, y_dest](float x, float y)
+      {
+        x -= x_dest;
+        y -= y_dest;
+        return sqrt(x * x + y * y) * __pts_per_unit;
+      };
+      auto reached = [to](int current){return current == to;};
+
+      //the second search runs on warm caches, so the order alternates
+      bool found = true;
+      int heap_len = 0, queue_len = 0;
+      for(int k = 0; k < 2; ++k)
+      {
+        auto start = Clock::now();
+        if((n + k) % 2 == 0)
+        {
+          found &= _searchTrianglesIn(heap, scratch, from,
+                                      dest_dist, reached);
+          auto end = Clock::now();
+          *heap_ns +=
+            std::chrono::duration<double, std::nano>(end - start).count();
+          heap_len = scratch.status_map[to].travel_len;
+        }
+        else
+        {
+          found &= _searchTrianglesIn(queue, scratch, from,
+                                      dest_dist, reached);
+          auto end = Clock::now();
+          *queue_ns +=
+            std::chrono::duration<double, std::nano>(end - start).count();
+          queue_len = scratch.status_map[to].travel_len;
+        }
+      }
+
+      if(found)
+      {
+        *length_ratio += (double)heap_len / queue_len;
+        ++searched;
+      }
+    }
+    if(searched != 0)
+      *length_ratio /= searched;
+    return searched;
+  }
+#endif
+
+  //collision detection
+  bool isBlocked(float x, float y)
+  {
+    if(_locator_buckets.empty()) return false;
+    return _locateTriangle(x, y) == -1;
+  }
+
+  //hint is the caller's last known triangle, it is moved to the triangle
+  //containing x, y and kept when the point is blocked
+  bool isBlocked(float x, float y, int& hint)
+  {
+    if(_locator_buckets.empty()) return false;
+    int tri = _walkToTriangle(hint, x, y);
+    if(tri == -1)
+      return true;
+    hint = tri;
+    return false;
+  }
+
+  void pushIn(float& x, float& y, float last_x, float last_y)
+  {
+    int hint = -1;
+    pushIn(x, y, last_x, last_y, hint);
+  }
+
+  void pushIn(float& x, float& y, float last_x, float last_y, int& hint)
+  {
+    __SquaredDistFunctor<decltype(NavMeshVert::first)> dist_func(x, y);
+  
+    int tri_i = _walkToTriangle(hint, last_x, last_y);
+    
+    //there is no edge to push back over from off the mesh, the point goes
+    //to the nearest part of the mesh instead
+    if(tri_i == -1)
+    {
+      tri_i = _snapToComponent(-1, x, y);
+      if(tri_i != -1)
+        hint = tri_i;
+      return;
+    }
+
+    hint = tri_i;
+
+    //triangle bounds
+    __NavMeshTriangle& tri = _navmesh_triangles[tri_i];
+    NavMeshVert v1 = _navmesh_verts[tri.indices[0]];
+    NavMeshVert v2 = _navmesh_verts[tri.indices[1]];
+    NavMeshVert v3 = _navmesh_verts[tri.indices[2]];
+    
+    //biasing (this could prevent chraches)
+    /*constexpr double bias = 10.;
+    v1.first += (tri.center_x - v1.first) / bias;
+    v1.second += (tri.center_y - v1.second) / bias;
+    v2.first += (tri.center_x - v2.first) / bias;
+    v2.second += (tri.center_y - v2.second) / bias;
+    v3.first += (tri.center_x - v3.first) / bias;
+    v3.second += (tri.center_y - v3.second) / bias;*/
+    
+    NavMeshVert point = {x, y};
+    int corner = 0;
+    double dist_sq, ratio;
+    
+    do
+    {
+      if(_dotProduct(v2 - v1, _turn90d(point - v1)) > 0.)
+      {
+        dist_sq = _dotProduct(v2 - v1, v2 - v1);
+        ratio = _dotProduct(v2 - v1, point - v1) / dist_sq;
+        
+        if(ratio < 0.)
+          corner = 1;
+        else if(ratio > 1.)
+          corner = 2;
+        else
+        {
+          point = v2 * ratio + v1 * (1. - ratio);
+          break;
+        }
+      }
+      if(corner != 1 && _dotProduct(v3 - v2, _turn90d(point - v2)) > 0.)
+      {
+        dist_sq = _dotProduct(v3 - v2, v3 - v2);
+        ratio = _dotProduct(v3 - v2, point - v2) / dist_sq;
+        
+        if(ratio < 0.)
+          corner = 2;
+        else if(ratio > 1.)
+          corner = 3;
+        else
+        {
+          point = v3 * ratio + v2 * (1. - ratio);
+          break;
+        }
+      }
+      if(corner != 2 && _dotProduct(v1 - v3, _turn90d(point - v3)) > 0.)
+      {
+        dist_sq = _dotProduct(v1 - v3, v1 - v3);
+        ratio = _dotProduct(v1 - v3, point - v3) / dist_sq;
+        
+        if(ratio < 0.)
+          corner = 3;
+        else if(ratio > 1.)
+          corner = 1;
+        else
+        {
+          point = v1 * ratio + v3 * (1. - ratio);
+          break;
+        }
+      }
+      
+      switch(corner)
+      {
+      case 1:
+        point = v1;
+        break;
+      case 2:
+        point = v2;
+        break;
+      case 3:
+        point = v3;
+        break;
+#ifndef NDEBUG
+      default:
+        printf("switch fell through in WorldGeo::pushIn\n%s: %i\n",
+                __FILE__, __LINE__);
+        break;
+#endif
+      }
+    }while(false);
+    
+    //printf("last_point: %f : %f\n", last_x, last_y);
+    //printf("next_point: %f : %f\n", x, y);
+    //printf("middle: %f : %f\n", point.first, point.second);
+    
+    x = point.first;
+    y = point.second;
+  }
+
+
+  //triangulates one tile, each plate of free cells separately
+  void __buildNavTile(NMC_Plate& plate, int tile_x, int tile_y)
+  {
+    using u16pair = std::pair<uint16_t, uint16_t>;
+
+    __NavTile& tile = _nav_tiles[tile_x + tile_y * _nav_tiles_w];
+    int x0 = tile_x * __nav_tile_size;
+    int y0 = tile_y * __nav_tile_size;
+    int x1 = std::min(x0 + __nav_tile_size, (int)_mapsize_w);
+    int y1 = std::min(y0 + __nav_tile_size, (int)_mapsize_h);
+    int tile_w = x1 - x0;
+    int tile_h = y1 - y0;
+
+    tile.verts.clear();
+    tile.vert_cons.clear();
+    tile.triangles.clear();
+    tile.plate_ofsets.assign(1, 0);
+    tile.plate_vert_ofsets.assign(1, 0);
+    tile.dirty = false;
+
+    //the outermost cells of the map are always blocked
+    auto is_free = [](int x, int y)
+    {
+      return x > 0 && y > 0 && x < _mapsize_w - 1 && y < _mapsize_h - 1
+        && !_blocked_map->test(x + y * _mapsize_w) && !_isCarved(x, y);
+    };
+
+    //label free cells by plate, -1 is blocked
+    std::vector<int> labels(tile_w * tile_h, -1);
+    std::vector<u16pair> starts;
+    std::stack<u16pair> open_stack;
+
+    for(int y = y0; y < y1; ++y)
+    for(int x = x0; x < x1; ++x)
+    {
+      if(!is_free(x, y) || labels[x - x0 + (y - y0) * tile_w] != -1)
+        continue;
+
+      int label = starts.size();
+      starts.push_back(u16pair(x, y));
+      open_stack.push(u16pair(x, y));
+      do
+      {
+        int samp_x = open_stack.top().first;
+        int samp_y = open_stack.top().second;
+        open_stack.pop();
+
+        if(samp_x < x0 || samp_y < y0 || samp_x >= x1 || samp_y >= y1
+          || !is_free(samp_x, samp_y))
+          continue;
+        int& samp = labels[samp_x - x0 + (samp_y - y0) * tile_w];
+        if(samp != -1)
+          continue;
+
+        samp = label;
+        open_stack.push(u16pair(samp_x - 1, samp_y));
+        open_stack.push(u16pair(samp_x + 1, samp_y));
+        open_stack.push(u16pair(samp_x, samp_y - 1));
+        open_stack.push(u16pair(samp_x, samp_y + 1));
+      }while(!open_stack.empty());
+    }
+
+    if(starts.empty())
+      return;
+
+    //holes are blocked regions which do not reach the tile border
+    std::vector<std::pair<int, u16pair>> holes;
+    {
+      std::vector<bool> seen(tile_w * tile_h, false);
+      for(int y = y0; y < y1; ++y)
+      for(int x = x0; x < x1; ++x)
+      {
+        if(labels[x - x0 + (y - y0) * tile_w] != -1
+          || seen[x - x0 + (y - y0) * tile_w])
+          continue;
+
+        bool not_hole = false;
+        open_stack.push(u16pair(x, y));
+        do
+        {
+          int samp_x = open_stack.top().first;
+          int samp_y = open_stack.top().second;
+          open_stack.pop();
+
+          if(samp_x < x0 || samp_y < y0 || samp_x >= x1 || samp_y >= y1)
+          {
+            not_hole = true;
+            continue;
+          }
+          int idx = samp_x - x0 + (samp_y - y0) * tile_w;
+          if(labels[idx] != -1 || seen[idx])
+            continue;
+
+          seen[idx] = true;
+          open_stack.push(u16pair(samp_x - 1, samp_y));
+          open_stack.push(u16pair(samp_x + 1, samp_y));
+          open_stack.push(u16pair(samp_x, samp_y - 1));
+          open_stack.push(u16pair(samp_x, samp_y + 1));
+        }while(!open_stack.empty());
+
+        //the cell above the first cell of a hole belongs to its plate
+        if(!not_hole)
+          holes.push_back({labels[x - x0 + (y - 1 - y0) * tile_w],
+                          u16pair(x, y)});
+      }
+    }
+
+    //border points where either side changes between free and blocked
+    std::vector<bool> breaks((tile_w + 1) * 2 + (tile_h + 1) * 2);
+    for(int x = x0; x <= x1; ++x)
+    {
+      breaks[x - x0] = x == x0 || x == x1
+        || is_free(x - 1, y0 - 1) != is_free(x, y0 - 1)
+        || is_free(x - 1, y0) != is_free(x, y0);
+      breaks[tile_w + 1 + x - x0] = x == x0 || x == x1
+        || is_free(x - 1, y1 - 1) != is_free(x, y1 - 1)
+        || is_free(x - 1, y1) != is_free(x, y1);
+    }
+    for(int y = y0; y <= y1; ++y)
+    {
+      int ofset = (tile_w + 1) * 2;
+      breaks[ofset + y - y0] = y == y0 || y == y1
+        || is_free(x0 - 1, y - 1) != is_free(x0 - 1, y)
+        || is_free(x0, y - 1) != is_free(x0, y);
+      ofset += tile_h + 1;
+      breaks[ofset + y - y0] = y == y0 || y == y1
+        || is_free(x1 - 1, y - 1) != is_free(x1 - 1, y)
+        || is_free(x1, y - 1) != is_free(x1, y);
+    }
+    plate.setTile(x0, y0, x1, y1, std::move(breaks));
+
+    for(unsigned label = 0; label < starts.size(); ++label)
+    {
+      for(int y = y0; y < y1; ++y)
+      for(int x = x0; x < x1; ++x)
+      {
+        if(labels[x - x0 + (y - y0) * tile_w] == (int)label)
+          plate.set(x + y * _mapsize_w);
+      }
+      plate.setStart(starts[label].first, starts[label].second);
+      for(auto& hole: holes)
+      {
+        if(hole.first == (int)label)
+          plate.setHole(hole.second.first, hole.second.second);
+      }
+
+      plate.listVertices();
+      plate.triangulate();
+
+      int num_verts = tile.verts.size();
+      int num_triangles = tile.triangles.size();
+      for(auto it = plate.vBegin(); it != plate.vEnd(); ++it)
+      {
+        tile.verts.push_back(*it);
+        tile.vert_cons.push_back(
+          {it->first_con + num_verts, it->second_con + num_verts});
+      }
+      tile.triangles.insert(tile.triangles.end(),
+                            plate.tBegin(), plate.tEnd());
+      std::for_each(tile.triangles.begin() + num_triangles,
+                    tile.triangles.end(),
+                    [=](__NavMeshTriangle& tri)
+                    {tri.addToIndices(num_verts);
+                      tri.addToCons(num_triangles);});
+      tile.plate_ofsets.push_back(tile.triangles.size());
+      tile.plate_vert_ofsets.push_back(tile.verts.size());
+
+      for(int y = y0; y < y1; ++y)
+      for(int x = x0; x < x1; ++x)
+        plate.reset(x + y * _mapsize_w);
+      plate.clear();
+    }
+  }
+
+  //concatenates the tiles and links triangles across tile borders
+  void __assembleNavMesh()
+  {
+    _navmesh_verts.clear();
+    _navmesh_vert_cons.clear();
+    _navmesh_triangles.clear();
+
+    int num_plates = 0;
+    for(auto& tile: _nav_tiles)
+      num_plates += tile.plate_ofsets.size() - 1;
+
+    delete[] _plate_ofsets;
+    delete[] _plate_vert_ofsets;
+    _plate_ofsets = new int[num_plates + 1];
+    _plate_vert_ofsets = new int[num_plates + 1];
+    _num_plates = 0;
+
+    auto on_border = [](const NavMeshVert& v)
+    {
+      return (int)v.first % __nav_tile_size == 0
+        || (int)v.second % __nav_tile_size == 0;
+    };
+
+    /*
+      neighbouring tiles list the same vertices along their common border,
+      only the first one is kept. vertices are appended plate by plate so
+      a plate keeps its own vertices in one range.
+    */
+    std::vector<std::pair<NavMeshVert, int>> border_verts;
+    {
+      int idx = 0;
+      for(auto& tile: _nav_tiles)
+      for(auto& v: tile.verts)
+      {
+        if(on_border(v))
+          border_verts.push_back({v, idx});
+        ++idx;
+      }
+      std::sort(border_verts.begin(), border_verts.end());
+    }
+
+    std::vector<int> remap;
+    for(auto& tile: _nav_tiles)
+    {
+      int num_verts = remap.size();
+      tile.plates.clear();
+      int num_triangles = _navmesh_triangles.size();
+
+      for(unsigned n = 0; n + 1 < tile.plate_ofsets.size(); ++n)
+      {
+        _plate_ofsets[_num_plates] = num_triangles + tile.plate_ofsets[n];
+        _plate_vert_ofsets[_num_plates] = _navmesh_verts.size();
+        tile.plates.push_back(_num_plates);
+        ++_num_plates;
+
+        for(int v = tile.plate_vert_ofsets[n];
+            v < tile.plate_vert_ofsets[n + 1]; ++v)
+        {
+          auto& vert = tile.verts[v];
+          int first = num_verts + v;
+          if(on_border(vert))
+            first = std::lower_bound(border_verts.begin(), border_verts.end(),
+                                    std::make_pair(vert, 0))->second;
+
+          if(first == num_verts + v)
+          {
+            remap.push_back(_navmesh_verts.size());
+            _navmesh_verts.push_back(vert);
+          }
+          else remap.push_back(remap[first]);
+        }
+      }
+
+      for(auto& con: tile.vert_cons)
+        _navmesh_vert_cons.push_back(
+          {con.first + num_verts, con.second + num_verts});
+
+      _navmesh_triangles.insert(_navmesh_triangles.end(),
+                                tile.triangles.begin(), tile.triangles.end());
+      std::for_each(_navmesh_triangles.begin() + num_triangles,
+                    _navmesh_triangles.end(),
+                    [&](__NavMeshTriangle& tri)
+                    {for(auto& i: tri.indices) i = remap[num_verts + i];
+                      tri.addToCons(num_triangles);});
+    }
+
+    _plate_ofsets[_num_plates] = _navmesh_triangles.size();
+    _plate_vert_ofsets[_num_plates] = _navmesh_verts.size();
+
+    {
+      //a shared vertex keeps the outline of its first tile
+      std::vector<std::pair<int, int>> vert_cons(_navmesh_verts.size(),
+                                                {-1, -1});
+      for(unsigned n = 0; n < remap.size(); ++n)
+      {
+        if(vert_cons[remap[n]].first == -1)
+          vert_cons[remap[n]] = {remap[_navmesh_vert_cons[n].first],
+                                remap[_navmesh_vert_cons[n].second]};
+      }
+      _navmesh_vert_cons = std::move(vert_cons);
+    }
+
+    //open edges between two border vertices are matched across tiles
+    std::vector<__BorderEdge> edges;
+    for(unsigned n = 0; n < _navmesh_triangles.size(); ++n)
+    {
+      auto& tri = _navmesh_triangles[n];
+      for(int k = 0; k < 3; ++k)
+      {
+        int vert1 = tri.indices[k];
+        int vert2 = tri.indices[(k + 1) % 3];
+        if(tri.cons[k] != -1 || !on_border(_navmesh_verts[vert1])
+          || !on_border(_navmesh_verts[vert2]))
+          continue;
+
+        edges.push_back({std::min(vert1, vert2), std::max(vert1, vert2),
+                        (int)n, k});
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    //plates joined by a link share a component
+    std::vector<int> roots(_num_plates);
+    for(int n = 0; n < _num_plates; ++n)
+      roots[n] = n;
+    auto find_root = [&roots](int n)
+    {
+      while(roots[n] != n)
+        n = roots[n] = roots[roots[n]];
+      return n;
+    };
+
+    for(unsigned n = 1; n < edges.size(); ++n)
+    {
+      if(!(edges[n] == edges[n - 1]))
+        continue;
+
+      auto& first = edges[n - 1];
+      auto& second = edges[n];
+      _navmesh_triangles[first.triangle].cons[first.con] = second.triangle;
+      _navmesh_triangles[second.triangle].cons[second.con] = first.triangle;
+
+      int a = find_root(_getPlate(first.triangle));
+      int b = find_root(_getPlate(second.triangle));
+      if(a != b)
+        roots[std::max(a, b)] = std::min(a, b);
+    }
+
+    _plate_components.resize(_num_plates);
+    for(int n = 0; n < _num_plates; ++n)
+      _plate_components[n] = find_root(n);
+
+    std::for_each(_navmesh_verts.begin(),
+      _navmesh_verts.end(), [](NavMeshVert& v)
+        {v.first /= 8; v.second /= 8;});
+  }
+
+  /*
+    tiles only read the blocked map and write their own __NavTile, so the
+    path workers (idle while the mesh is rebuilt) share them with the
+    calling thread, one tile at a time. assembly walks the tiles in index
+    order, the result does not depend on which thread built which tile.
+  */
+  void __buildNavTiles(const std::vector<int>& tiles)
+  {
+    auto build = [&tiles](unsigned begin, unsigned end)
+    {
+      NMC_Plate plate(_mapsize_w);
+      for(unsigned n = begin; n < end; ++n)
+        __buildNavTile(plate, tiles[n] % _nav_tiles_w, tiles[n] / _nav_tiles_w);
+    };
+
+    if(tiles.size() <= 1)
+    {
+      build(0, tiles.size());
+      return;
+    }
+    _startPathWorkers();
+    _path_workers->parallelFor(tiles.size(), 1, build);
+  }
+
+  ///navmesh cache
+  constexpr uint32_t __navmesh_cache_magic = 0x4d4e4c44;    //"DLNM"
+  constexpr uint32_t __navmesh_cache_version = 3;
+
+  struct __NavMeshCacheHeader
+  {
+    uint32_t magic, version;
+    uint32_t width, height;
+    uint64_t map_hash;
+    uint32_t num_verts, num_triangles, num_plates;
+    uint32_t locator_w, locator_h, num_locator_entries;
+  };
+
+  static_assert(std::is_trivially_copyable<__NavMeshTriangle>::value &&
+                std::is_trivially_copyable<__LocatorEntry>::value &&
+                std::is_trivially_copyable<__BucketRange>::value,
+                "navmesh cache sections are copied as bytes");
+
+  //hashes the whole bitset a word at a time, testing the cells one by one
+  //costs more than loading the file. the hash is only stable for one
+  //standard library, a different one just rebuilds the cache
+  uint64_t __hashBlockedMap()
+  {
+    return std::hash<BlockedMapT>()(*_blocked_map);
+  }
+
+  //the arrays stored after the header, sized by the header
+  std::vector<std::pair<void*, size_t>>
+  __cacheSections(const __NavMeshCacheHeader& header)
+  {
+    size_t plates = header.num_plates;
+    size_t buckets = (size_t)header.locator_w * header.locator_h;
+    return {
+      {_navmesh_verts.data(), header.num_verts * sizeof(NavMeshVert)},
+      {_navmesh_vert_cons.data(),
+        header.num_verts * sizeof(std::pair<int, int>)},
+      {_navmesh_triangles.data(),
+        header.num_triangles * sizeof(__NavMeshTriangle)},
+      {_plate_ofsets, (plates + 1) * sizeof(int)},
+      {_plate_vert_ofsets, (plates + 1) * sizeof(int)},
+      {_plate_components.data(), plates * sizeof(int)},
+      {_locator_buckets.data(), buckets * sizeof(__BucketRange)},
+      {_locator_entries.data(),
+        header.num_locator_entries * sizeof(__LocatorEntry)}};
+  }
+
+  inline size_t __cacheSectionOfset(size_t size)
+  {
+    return (size + 7) & ~(size_t)7;
+  }
+
+  bool __writeCacheSection(FILE* file, const void* data, size_t size)
+  {
+    static const char padding[8] = {};
+    size_t pad = __cacheSectionOfset(size) - size;
+    return fwrite(data, 1, size, file) == size
+      && fwrite(padding, 1, pad, file) == pad;
+  }
+
+  //internal distances, center and clearances from vertices and connections
+  void __finalizeTriangle(__NavMeshTriangle& tri)
+  {
+    //reorder connections
+
+    //calculate internal distances
+    NavMeshVert con0, con1, con2;
+    NavMeshVert vert0, vert1, vert2;
+    vert0 = _navmesh_verts[tri.indices[0]];
+    vert1 = _navmesh_verts[tri.indices[1]];
+    vert2 = _navmesh_verts[tri.indices[2]];
+    con0 = (vert0 + vert1) / 2;
+    con1 = (vert1 + vert2) / 2;
+    con2 = (vert2 + vert0) / 2;
+    tri.dists[0] = __pts_per_unit * _distance(con0, con1);
+    tri.dists[1] = __pts_per_unit * _distance(con1, con2);
+    tri.dists[2] = __pts_per_unit * _distance(con2, con0);
+    vert0 = (con0 + con1 + con2) / 3;
+    tri.center_x = vert0.first;
+    tri.center_y = vert0.second;
+
+    /*
+      clearance between two connections: both portals have to fit the
+      unit, and if the third side is outline, so does the gap between it
+      and the corner the portals share. an open third side is taken as
+      wide enough, which overestimates triangles next to narrow ones.
+    */
+    for(int k = 0; k < 3; ++k)
+    {
+      NavMeshVert corner = _navmesh_verts[tri.indices[(k + 1) % 3]];
+      NavMeshVert side1 = _navmesh_verts[tri.indices[(k + 2) % 3]];
+      NavMeshVert side2 = _navmesh_verts[tri.indices[k]];
+      float clearance = std::min(_distance(side2, corner),
+                                 _distance(corner, side1));
+      if(tri.cons[(k + 2) % 3] == -1)
+      {
+        NavMeshVert side = side2 - side1;
+        double ratio = _dotProduct(corner - side1, side)
+                      / _dotProduct(side, side);
+        ratio = std::min(std::max(ratio, 0.), 1.);
+        clearance = std::min(clearance,
+          (float)_distance(corner, side1 + side * ratio));
+      }
+      tri.clearance[k] = clearance;
+    }
+  }
+
+  bool __hasObstacles()
+  {
+    for(auto& obstacle: _obstacles)
+    {
+      if(obstacle)
+        return true;
+    }
+    return false;
+  }
+
+  //cell bounds to the tiles to build again, border vertices depend on
+  //the cells on both sides of a tile border
+  void __tileBounds(int& x_begin, int& y_begin, int& x_end, int& y_end)
+  {
+    x_begin = std::max(x_begin - 1, 0) / __nav_tile_size;
+    y_begin = std::max(y_begin - 1, 0) / __nav_tile_size;
+    x_end = std::min(x_end / __nav_tile_size + 1, _nav_tiles_w);
+    y_end = std::min(y_end / __nav_tile_size + 1, _nav_tiles_h);
+  }
+
+  //which tile every plate lies in, for a navmesh not assembled from tiles
+  void __listTilePlates()
+  {
+    for(auto& tile: _nav_tiles)
+      tile.plates.clear();
+    for(int plate = 0; plate < _num_plates; ++plate)
+    {
+      if(_plate_ofsets[plate] == _plate_ofsets[plate + 1])
+        continue;
+      auto& tri = _navmesh_triangles[_plate_ofsets[plate]];
+      int x = tri.center_x * 8 / __nav_tile_size;
+      int y = tri.center_y * 8 / __nav_tile_size;
+      _nav_tiles[x + y * _nav_tiles_w].plates.push_back(plate);
+    }
+  }
+
+  /*
+    triangulates the tiles tx0 <= x < tx1, ty0 <= y < ty1 again and appends
+    them to the global arrays. their old triangles are killed, the
+    triangles around them are linked to the new ones and the locator and
+    outline buckets over them are rewritten. components joined by the new
+    triangles are merged, a component cut in two keeps one id.
+  */
+  void __spliceNavTiles(int tx0, int ty0, int tx1, int ty1)
+  {
+    _holdPathRequests();
+
+    std::vector<int> tiles;
+    for(int y = ty0; y < ty1; ++y)
+    for(int x = tx0; x < tx1; ++x)
+      tiles.push_back(x + y * _nav_tiles_w);
+    __buildNavTiles(tiles);
+
+    //live triangles of the surrounding tiles
+    std::vector<int> near;
+    for(int y = std::max(ty0 - 1, 0); y < std::min(ty1 + 1, _nav_tiles_h); ++y)
+    for(int x = std::max(tx0 - 1, 0); x < std::min(tx1 + 1, _nav_tiles_w); ++x)
+    {
+      if(x >= tx0 && x < tx1 && y >= ty0 && y < ty1)
+        continue;
+      for(int plate: _nav_tiles[x + y * _nav_tiles_w].plates)
+      for(int tri = _plate_ofsets[plate]; tri < _plate_ofsets[plate + 1]; ++tri)
+        near.push_back(tri);
+    }
+    std::sort(near.begin(), near.end());
+
+    int new_plates = 0;
+    for(int t: tiles)
+    {
+      for(int plate: _nav_tiles[t].plates)
       {
-        dist_sq = _dotProduct(v2 - v1, v2 - v1);
-        ratio = _dotProduct(v2 - v1, point - v1) / dist_sq;
-        
-        if(ratio < 0.)
-          corner = 1;
-        else if(ratio > 1.)
-          corner = 2;
-        else
+        _plate_components[plate] = -1;
+        for(int tri = _plate_ofsets[plate]; tri < _plate_ofsets[plate + 1];
+            ++tri)
         {
-          point = v2 * ratio + v1 * (1. - ratio);
-          break;
+          _navmesh_triangles[tri].kill();
+          ++_dead_triangles;
         }
       }
-      if(corner != 1 && _dotProduct(v3 - v2, _turn90d(point - v2)) > 0.)
+      new_plates += _nav_tiles[t].plate_ofsets.size() - 1;
+    }
+
+    {
+      int* plate_ofsets = new int[_num_plates + new_plates + 1];
+      int* plate_vert_ofsets = new int[_num_plates + new_plates + 1];
+      std::copy(_plate_ofsets, _plate_ofsets + _num_plates + 1, plate_ofsets);
+      std::copy(_plate_vert_ofsets, _plate_vert_ofsets + _num_plates + 1,
+                plate_vert_ofsets);
+      delete[] _plate_ofsets;
+      delete[] _plate_vert_ofsets;
+      _plate_ofsets = plate_ofsets;
+      _plate_vert_ofsets = plate_vert_ofsets;
+    }
+
+    //in cells, like the tiles
+    auto on_border = [](const NavMeshVert& v)
+    {
+      return (int)v.first % __nav_tile_size == 0
+        || (int)v.second % __nav_tile_size == 0;
+    };
+
+    //border vertices are shared with the surrounding tiles by position
+    std::vector<std::pair<NavMeshVert, int>> border_verts;
+    for(int tri: near)
+    {
+      for(int i: _navmesh_triangles[tri].indices)
       {
-        dist_sq = _dotProduct(v3 - v2, v3 - v2);
-        ratio = _dotProduct(v3 - v2, point - v2) / dist_sq;
-        
-        if(ratio < 0.)
-          corner = 2;
-        else if(ratio > 1.)
-          corner = 3;
-        else
-        {
-          point = v3 * ratio + v2 * (1. - ratio);
-          break;
-        }
+        NavMeshVert v = _navmesh_verts[i] * 8;
+        if(on_border(v))
+          border_verts.push_back({v, i});
       }
-      if(corner != 2 && _dotProduct(v1 - v3, _turn90d(point - v3)) > 0.)
+    }
+    std::sort(border_verts.begin(), border_verts.end());
+    border_verts.erase(std::unique(border_verts.begin(), border_verts.end()),
+                       border_verts.end());
+
+    int first_plate = _num_plates;
+    int first_triangle = _navmesh_triangles.size();
+    std::vector<int> remap;
+    std::vector<int> added;
+    for(int t: tiles)
+    {
+      __NavTile& tile = _nav_tiles[t];
+      int num_triangles = _navmesh_triangles.size();
+      remap.assign(tile.verts.size(), -1);
+      added.clear();
+      tile.plates.clear();
+
+      for(unsigned n = 0; n + 1 < tile.plate_ofsets.size(); ++n)
       {
-        dist_sq = _dotProduct(v1 - v3, v1 - v3);
-        ratio = _dotProduct(v1 - v3, point - v3) / dist_sq;
-        
-        if(ratio < 0.)
-          corner = 3;
-        else if(ratio > 1.)
-          corner = 1;
-        else
+        _plate_ofsets[_num_plates] = num_triangles + tile.plate_ofsets[n];
+        _plate_vert_ofsets[_num_plates] = _navmesh_verts.size();
+        _plate_components.push_back(_num_plates);
+        tile.plates.push_back(_num_plates);
+        ++_num_plates;
+
+        for(int v = tile.plate_vert_ofsets[n];
+            v < tile.plate_vert_ofsets[n + 1]; ++v)
         {
-          point = v1 * ratio + v3 * (1. - ratio);
-          break;
+          auto& vert = tile.verts[v];
+          if(on_border(vert))
+          {
+            auto it = std::lower_bound(border_verts.begin(), border_verts.end(),
+                                       std::make_pair(vert, -1));
+            if(it != border_verts.end() && it->first == vert)
+            {
+              remap[v] = it->second;
+              continue;
+            }
+            border_verts.insert(it, {vert, (int)_navmesh_verts.size()});
+          }
+          remap[v] = _navmesh_verts.size();
+          added.push_back(v);
+          _navmesh_verts.push_back(vert / 8);
         }
       }
-      
-      switch(corner)
+
+      for(int v: added)
+        _navmesh_vert_cons.push_back({remap[tile.vert_cons[v].first],
+                                      remap[tile.vert_cons[v].second]});
+
+      _navmesh_triangles.insert(_navmesh_triangles.end(),
+                                tile.triangles.begin(), tile.triangles.end());
+      std::for_each(_navmesh_triangles.begin() + num_triangles,
+                    _navmesh_triangles.end(),
+                    [&](__NavMeshTriangle& tri)
+                    {for(auto& i: tri.indices) i = remap[i];
+                      tri.addToCons(num_triangles);});
+    }
+    _plate_ofsets[_num_plates] = _navmesh_triangles.size();
+    _plate_vert_ofsets[_num_plates] = _navmesh_verts.size();
+
+    for(int tri: near)
+    {
+      for(auto& con: _navmesh_triangles[tri].cons)
       {
-      case 1:
-        point = v1;
-        break;
-      case 2:
-        point = v2;
-        break;
-      case 3:
-        point = v3;
-        break;
-#ifndef NDEBUG
-      default:
-        printf("switch fell through in WorldGeo::pushIn\n%s: %i\n",
-                __FILE__, __LINE__);
-        break;
-#endif
+        if(con != -1 && _navmesh_triangles[con].dead())
+          con = -1;
       }
-    }while(false);
-    
-    //printf("last_point: %f : %f\n", last_x, last_y);
-    //printf("next_point: %f : %f\n", x, y);
-    //printf("middle: %f : %f\n", point.first, point.second);
-    
-    x = point.first;
-    y = point.second;
-  }
+    }
 
+    //open edges on tile borders are matched like in the assembly
+    std::vector<__BorderEdge> edges;
+    auto list_edges = [&](int n)
+    {
+      auto& tri = _navmesh_triangles[n];
+      for(int k = 0; k < 3; ++k)
+      {
+        int vert1 = tri.indices[k];
+        int vert2 = tri.indices[(k + 1) % 3];
+        if(tri.cons[k] == -1 && on_border(_navmesh_verts[vert1] * 8)
+          && on_border(_navmesh_verts[vert2] * 8))
+          edges.push_back({std::min(vert1, vert2), std::max(vert1, vert2),
+                          n, k});
+      }
+    };
+    for(int tri: near)
+      list_edges(tri);
+    for(int n = first_triangle; n < (int)_navmesh_triangles.size(); ++n)
+      list_edges(n);
+    std::sort(edges.begin(), edges.end());
+
+    //labels of new plates are their own ids until joined
+    auto join = [first_plate](int a, int b)
+    {
+      a = _plate_components[a];
+      b = _plate_components[b];
+      if(a == b)
+        return;
+      int from = std::max(a, b);
+      int to = std::min(a, b);
+      if(from >= first_plate)
+      {
+        for(int n = first_plate; n < _num_plates; ++n)
+          if(_plate_components[n] == from)
+            _plate_components[n] = to;
+        return;
+      }
+      for(auto& component: _plate_components)
+        if(component == from)
+          component = to;
+      for(auto& edge: _outline_edges)
+        if(edge.component == from)
+          edge.component = to;
+    };
 
-  inline void __constructNavMeshHelper(BlockedMapT* helper)
-  {
-    //make a square of tiles around helper_total
-    for(int n = 0; n < _mapsize_w; ++n)
+    for(unsigned n = 1; n < edges.size(); ++n)
     {
-      helper->set(n);
-      helper->set(n + (_mapsize_h - 1) * _mapsize_w);
+      if(!(edges[n] == edges[n - 1]))
+        continue;
+
+      auto& first = edges[n - 1];
+      auto& second = edges[n];
+      _navmesh_triangles[first.triangle].cons[first.con] = second.triangle;
+      _navmesh_triangles[second.triangle].cons[second.con] = first.triangle;
+      join(_getPlate(first.triangle), _getPlate(second.triangle));
     }
-    for(int n = 0; n < _mapsize_h; ++n)
+
+    std::vector<int> tris(near);
+    for(int n = first_triangle; n < (int)_navmesh_triangles.size(); ++n)
+      tris.push_back(n);
+    for(int n: tris)
+      __finalizeTriangle(_navmesh_triangles[n]);
+
+    //the buckets of the tiles and one more ring, which the triangles along
+    //the tile borders reach into
+    int bucket_tile = __nav_tile_size / 8;
+    int bx0 = std::max(tx0 * bucket_tile - 1, 0);
+    int by0 = std::max(ty0 * bucket_tile - 1, 0);
+    int bx1 = std::min(tx1 * bucket_tile + 1, _locator_w);
+    int by1 = std::min(ty1 * bucket_tile + 1, _locator_h);
+    _fillLocator(tris, bx0, by0, bx1, by1);
+    _fillOutlineIndex(tris, bx0, by0, bx1, by1);
+
+    //the cluster graph is left as it is, long searches step around dead
+    //triangles and new triangles are searched without it
+    _cluster_of.resize(_navmesh_triangles.size(), -1);
+    _cluster_local.resize(_navmesh_triangles.size(), -1);
+    _growSearchScratch();
+    ++_navmesh_generation;
+    _resumePathRequests();
+  }
+
+  //builds the tiles of an obstacle's cells again, compacting the navmesh
+  //once it holds too many dead triangles
+  void __carveObstacle(const __Obstacle& obstacle)
+  {
+    if(obstacle.cells.empty())
+      return;
+
+    int x_begin = obstacle.x_begin;
+    int y_begin = obstacle.y_begin;
+    int x_end = obstacle.x_end;
+    int y_end = obstacle.y_end;
+    __tileBounds(x_begin, y_begin, x_end, y_end);
+    __spliceNavTiles(x_begin, y_begin, x_end, y_end);
+
+    if(_dead_triangles * 3 > _navmesh_triangles.size())
+      setupNavMesh(_mapsize_w, _mapsize_h, _blocked_map);
+  }
+
+  //the tiles are only kept for the same map
+  void __resetNavTiles(int width, int height, BlockedMapT* blocked_map)
+  {
+    if(width != _mapsize_w || height != _mapsize_h
+      || blocked_map != _nav_tiles_map || _nav_tiles.empty())
     {
-      helper->set(n * _mapsize_w);
-      helper->set(_mapsize_w - 1 + n * _mapsize_w);
+      _nav_tiles_w = (width + __nav_tile_size - 1) / __nav_tile_size;
+      _nav_tiles_h = (height + __nav_tile_size - 1) / __nav_tile_size;
+      _nav_tiles.clear();
+      _nav_tiles.resize(_nav_tiles_w * _nav_tiles_h);
+      _nav_tiles_map = blocked_map;
+      //obstacles are carved into the tiles of one map
+      _obstacles.clear();
     }
   }
 
@@ -2167,205 +4971,383 @@ namespace WorldGeo
   {
     //clock_t cl = clock();
 
-    using u16pair = std::pair<uint16_t, uint16_t>;
-    using PlateType = NMC_Plate;
+    _holdPathRequests();
+    __resetNavTiles(width, height, blocked_map);
 
     _mapsize_w = width;
     _mapsize_h = height;
     _blocked_map = blocked_map;
 
-    std::unique_ptr<BlockedMapT> helper(new BlockedMapT);
+    std::vector<int> dirty_tiles;
+    for(unsigned n = 0; n < _nav_tiles.size(); ++n)
+    {
+      if(_nav_tiles[n].dirty)
+        dirty_tiles.push_back(n);
+    }
+    __buildNavTiles(dirty_tiles);
 
-    std::stack<u16pair> open_stack;
-    std::vector<NavMeshVert> navmesh_helper;
+    __assembleNavMesh();
+    _dead_triangles = 0;
+
+    for(auto& tri: _navmesh_triangles)
+      __finalizeTriangle(tri);
 
-    std::vector<PlateType*> plates;
+    _buildLocator();
+    _buildOutlineIndex();
 
-    _navmesh_verts.clear();
-    _navmesh_vert_cons.clear();
-    _navmesh_triangles.clear();
-    delete[] _status_map;
+    _buildHierarchy();
+    _resetSearchScratch();
+    ++_navmesh_generation;
+    _resumePathRequests();
+  }
 
-    //list plates
-    *helper = *_blocked_map;
-    __constructNavMeshHelper(helper.get());
+  void updateNavMesh()
+  {
+    if(_blocked_map == nullptr)
+      return;
 
-    for(int y = 1; y < _mapsize_h - 1; ++y)
-    for(int x = 1; x < _mapsize_w - 1; ++x)
+    for(auto& tile: _nav_tiles)
     {
-      if(!helper->test(x + y * _mapsize_w))
+      if(tile.dirty)
       {
-        //fill shit
-        PlateType* plate = new PlateType(_mapsize_w);
-        open_stack.push(u16pair(x, y));
+        setupNavMesh(_mapsize_w, _mapsize_h, _blocked_map);
+        return;
+      }
+    }
+  }
 
-        uint16_t samp_x, samp_y;
+  void invalidateNavMesh(int x_begin, int y_begin, int x_end, int y_end)
+  {
+    if(_nav_tiles.empty())
+      return;
 
-        do
-        {
-          samp_x = open_stack.top().first;
-          samp_y = open_stack.top().second;
-          open_stack.pop();
+    __tileBounds(x_begin, y_begin, x_end, y_end);
+    for(int y = y_begin; y < y_end; ++y)
+    for(int x = x_begin; x < x_end; ++x)
+      _nav_tiles[x + y * _nav_tiles_w].dirty = true;
+  }
 
-          if(!helper->test(samp_x + samp_y * _mapsize_w))
-          {
-            helper->set(samp_x + samp_y * _mapsize_w);
-            plate->set(samp_x + samp_y * _mapsize_w);
-            open_stack.push(u16pair(samp_x - 1, samp_y));
-            open_stack.push(u16pair(samp_x + 1, samp_y));
-            open_stack.push(u16pair(samp_x, samp_y - 1));
-            open_stack.push(u16pair(samp_x, samp_y + 1));
-          }
-        }while(!open_stack.empty());
-        plate->setStart(x, y);
-        plates.push_back(plate);
+  //tiles keep the cells carved by obstacles
+  void invalidateNavMesh()
+  {
+    for(auto& tile: _nav_tiles)
+      tile.dirty = true;
+  }
+
+  ObstacleId addObstacle(const PathPoint* footprint, unsigned size)
+  {
+    if(size < 3 || _locator_buckets.empty())
+      return 0;
+
+    //either winding, the sign of the area tells which side is inside
+    float area = 0.f;
+    float min_x = footprint[0].x, max_x = min_x;
+    float min_y = footprint[0].y, max_y = min_y;
+    for(unsigned n = 0; n < size; ++n)
+    {
+      const PathPoint& a = footprint[n];
+      const PathPoint& b = footprint[(n + 1) % size];
+      area += a.x * b.y - a.y * b.x;
+      min_x = std::min(min_x, a.x);
+      max_x = std::max(max_x, a.x);
+      min_y = std::min(min_y, a.y);
+      max_y = std::max(max_y, a.y);
+    }
+    float side = area < 0.f? -1.f : 1.f;
+
+    std::unique_ptr<__Obstacle> obstacle(new __Obstacle);
+    obstacle->x_begin = std::max((int)(min_x * 8), 0);
+    obstacle->y_begin = std::max((int)(min_y * 8), 0);
+    obstacle->x_end = std::min((int)(max_x * 8) + 1, (int)_mapsize_w);
+    obstacle->y_end = std::min((int)(max_y * 8) + 1, (int)_mapsize_h);
+    for(int y = obstacle->y_begin; y < obstacle->y_end; ++y)
+    for(int x = obstacle->x_begin; x < obstacle->x_end; ++x)
+    {
+      float cx = (x + .5f) / 8;
+      float cy = (y + .5f) / 8;
+      bool inside = true;
+      for(unsigned n = 0; n < size && inside; ++n)
+      {
+        const PathPoint& a = footprint[n];
+        const PathPoint& b = footprint[(n + 1) % size];
+        inside = side * ((b.x - a.x) * (cy - a.y) - (b.y - a.y) * (cx - a.x))
+          >= 0.f;
       }
+      if(inside)
+        obstacle->cells.push_back(x + y * _mapsize_w);
     }
 
-    //add holes
-    *helper = ~(*_blocked_map);
-    __constructNavMeshHelper(helper.get());
-
-    for(int y = 1; y < _mapsize_h - 1; ++y)
-    for(int x = 1; x < _mapsize_w - 1; ++x)
+    //a cell counts its obstacles in one byte, an obstacle on a cell which
+    //already has 255 is refused
+    auto tile_cells = [](int cell) -> std::vector<uint8_t>&
     {
-      if(!helper->test(x + y * _mapsize_w))
-      {
-        //fill shit
-        uint16_t samp_x, samp_y;
-        bool not_hole = false;
+      int x = cell % _mapsize_w;
+      int y = cell / _mapsize_w;
+      return _nav_tiles[x / __nav_tile_size
+        + y / __nav_tile_size * _nav_tiles_w].carved;
+    };
+    auto cell_index = [](int cell)
+    {
+      int x = cell % _mapsize_w;
+      int y = cell / _mapsize_w;
+      return x % __nav_tile_size + y % __nav_tile_size * __nav_tile_size;
+    };
+    for(int cell: obstacle->cells)
+    {
+      auto& carved = tile_cells(cell);
+      if(!carved.empty() && carved[cell_index(cell)] == 255)
+        return 0;
+    }
+    for(int cell: obstacle->cells)
+    {
+      auto& carved = tile_cells(cell);
+      if(carved.empty())
+        carved.assign(__nav_tile_size * __nav_tile_size, 0);
+      ++carved[cell_index(cell)];
+    }
 
-        open_stack.push(u16pair(x, y));
+    __carveObstacle(*obstacle);
 
-        do
-        {
-          samp_x = open_stack.top().first;
-          samp_y = open_stack.top().second;
-          open_stack.pop();
+    unsigned slot = 0;
+    while(slot < _obstacles.size() && _obstacles[slot])
+      ++slot;
+    if(slot == _obstacles.size())
+      _obstacles.emplace_back();
+    _obstacles[slot] = std::move(obstacle);
+    return slot + 1;
+  }
 
-          if(!not_hole && (samp_x == 0
-              || samp_x == (_mapsize_w - 1) ||
-              samp_y == 0
-              || samp_y == (_mapsize_h - 1)))
-            not_hole = true;
+  void removeObstacle(ObstacleId id)
+  {
+    if(id == 0 || id > _obstacles.size() || !_obstacles[id - 1])
+      return;
 
-          if(!helper->test(samp_x + samp_y * _mapsize_w))
-          {
-            helper->set(samp_x + samp_y * _mapsize_w);
-            open_stack.push(u16pair(samp_x - 1, samp_y));
-            open_stack.push(u16pair(samp_x + 1, samp_y));
-            open_stack.push(u16pair(samp_x, samp_y - 1));
-            open_stack.push(u16pair(samp_x, samp_y + 1));
-          }
-        }while(!open_stack.empty());
+    std::unique_ptr<__Obstacle> obstacle = std::move(_obstacles[id - 1]);
+    for(int cell: obstacle->cells)
+    {
+      int x = cell % _mapsize_w;
+      int y = cell / _mapsize_w;
+      --_nav_tiles[x / __nav_tile_size + y / __nav_tile_size * _nav_tiles_w]
+        .carved[x % __nav_tile_size + y % __nav_tile_size * __nav_tile_size];
+    }
+    if(!_locator_buckets.empty())
+      __carveObstacle(*obstacle);
+    else if(!obstacle->cells.empty())
+      invalidateNavMesh(obstacle->x_begin, obstacle->y_begin,
+                        obstacle->x_end, obstacle->y_end);
+  }
 
-        if(not_hole)
-          continue;
+  /*
+    navmesh cache files hold a header and the finished navmesh arrays, each
+    section starting on an 8 byte boundary. loading maps the file and
+    copies the sections out, skipping triangulation. a file for another
+    blocked map, or of another format, is rejected.
+  */
+  bool saveNavMesh(const char* path)
+  {
+    //the file is only checked against the blocked map
+    if(_blocked_map == nullptr || __hasObstacles() || _dead_triangles != 0)
+      return false;
 
-        for(auto ptr: plates)
-        {
-          if(ptr->operator[](x - 1 + (y - 1) * _mapsize_w))
-          {
-            ptr->setHole(x, y);
-            break;
-          }
-        }
-      }
+    __NavMeshCacheHeader header;
+    header.magic = __navmesh_cache_magic;
+    header.version = __navmesh_cache_version;
+    header.width = _mapsize_w;
+    header.height = _mapsize_h;
+    header.map_hash = __hashBlockedMap();
+    header.num_verts = _navmesh_verts.size();
+    header.num_triangles = _navmesh_triangles.size();
+    header.num_plates = _num_plates;
+    header.locator_w = _locator_w;
+    header.locator_h = _locator_h;
+    header.num_locator_entries = _locator_entries.size();
+
+    //written next to the target and renamed, readers never see half a file
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if(file == nullptr)
+    {
+      printf("Unable to write file \"%s\"\n", temp_path.c_str());
+      return false;
     }
 
-    helper = nullptr;
-    
-    _num_plates = 0;
-    _plate_ofsets = new int[plates.size() + 1];
-    _plate_vert_ofsets = new int[plates.size() + 1];
+    bool ok = __writeCacheSection(file, &header, sizeof(header));
+    for(auto& section: __cacheSections(header))
+      ok = ok && __writeCacheSection(file, section.first, section.second);
+    ok = fclose(file) == 0 && ok;
 
-    for(auto ptr: plates)
+    if(!ok || rename(temp_path.c_str(), path) != 0)
     {
-      ptr->listVertices();
-      ptr->triangulate();
-      int num_verts = _navmesh_verts.size();
-      int num_triangles = _navmesh_triangles.size();
-      
-      _plate_ofsets[_num_plates] = num_triangles;
-      _plate_vert_ofsets[_num_plates] = num_verts;
-      ++_num_plates;
-      
-      /*_navmesh_verts.insert(_navmesh_verts.end(), 
-                          ptr->vBegin(), ptr->vEnd());*/
-      
-      for(auto it = ptr->vBegin(); it != ptr->vEnd(); ++it)
-      {
-        _navmesh_verts.push_back(*it);
-        _navmesh_vert_cons.push_back(
-          {it->first_con + num_verts, it->second_con + num_verts});
-      }
-      
-      _navmesh_triangles.insert(_navmesh_triangles.end(),
-                              ptr->tBegin(), ptr->tEnd());
-      if(num_verts == 0)
-        continue;
-      std::for_each(_navmesh_triangles.begin() + num_triangles,
-                      _navmesh_triangles.end(),
-                    [=](__NavMeshTriangle& tri)
-                    {tri.addToIndices(num_verts);
-                      tri.addToCons(num_triangles);});
-      ptr->clear();
+      remove(temp_path.c_str());
+      return false;
     }
-    
-    _plate_ofsets[_num_plates] = _navmesh_triangles.size();
-    _plate_vert_ofsets[_num_plates] = _navmesh_verts.size();
+    return true;
+  }
 
-    std::for_each(_navmesh_verts.begin(),
-      _navmesh_verts.end(), [](NavMeshVert& v)
-        {v.first /= 8; v.second /= 8;});
+  bool loadNavMesh(const char* path, int width, int height,
+                   BlockedMapT* blocked_map)
+  {
+    //cache files have no carved cells
+    if(__hasObstacles())
+      return false;
 
-    //finalize navmesh triangles
-    for(auto& tri: _navmesh_triangles)
+    int fd = open(path, O_RDONLY);
+    if(fd == -1)
+      return false;
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0
+      || (size_t)file_stat.st_size < sizeof(__NavMeshCacheHeader))
     {
-      //reorder connections
-
-      //calculate internal distances
-      NavMeshVert con0, con1, con2;
-      NavMeshVert vert0, vert1, vert2;
-      vert0 = _navmesh_verts[tri.indices[0]];
-      vert1 = _navmesh_verts[tri.indices[1]];
-      vert2 = _navmesh_verts[tri.indices[2]];
-      con0 = (vert0 + vert1) / 2;
-      con1 = (vert1 + vert2) / 2;
-      con2 = (vert2 + vert0) / 2;
-      tri.dists[0] = __pts_per_unit * _distance(con0, con1);
-      tri.dists[1] = __pts_per_unit * _distance(con1, con2);
-      tri.dists[2] = __pts_per_unit * _distance(con2, con0);
-      vert0 = (con0 + con1 + con2) / 3;
-      tri.center_x = vert0.first;
-      tri.center_y = vert0.second;
-    }
-
-    //setup quadtree
-    if(_nav_mesh_triangle_tree_inited)
-      _nav_mesh_triangle_tree.destroy();
-    _nav_mesh_triangle_tree.create(16.,
-      (_mapsize_w + 127) / 128, (_mapsize_h + 127) / 128);
-    for(unsigned n = 0; n < _navmesh_triangles.size(); ++n)
-      _nav_mesh_triangle_tree.insert(n);
-    _nav_mesh_triangle_tree_inited = true;
+      close(fd);
+      return false;
+    }
+    size_t file_size = file_stat.st_size;
+    void* data = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED)
+      return false;
+
+    const __NavMeshCacheHeader& header = *(const __NavMeshCacheHeader*)data;
+    bool valid = header.magic == __navmesh_cache_magic
+      && header.version == __navmesh_cache_version
+      && (int)header.width == width && (int)header.height == height;
 
-    _status_map = new __Status[_navmesh_triangles.size()];
+    //the hash needs the map, the rest of the setup waits for a valid file
+    uint16_t old_w = _mapsize_w, old_h = _mapsize_h;
+    BlockedMapT* old_map = _blocked_map;
+    if(valid)
+    {
+      _mapsize_w = width;
+      _mapsize_h = height;
+      _blocked_map = blocked_map;
+      valid = header.map_hash == __hashBlockedMap();
+      _mapsize_w = old_w;
+      _mapsize_h = old_h;
+      _blocked_map = old_map;
+    }
+
+    size_t size = __cacheSectionOfset(sizeof(header));
+    if(valid)
+    {
+      for(auto& section: __cacheSections(header))
+        size += __cacheSectionOfset(section.second);
+      valid = size == file_size;
+    }
+    if(!valid)
+    {
+      munmap(data, file_size);
+      return false;
+    }
+
+    _holdPathRequests();
+    __resetNavTiles(width, height, blocked_map);
+    _mapsize_w = width;
+    _mapsize_h = height;
+    _blocked_map = blocked_map;
+
+    _navmesh_verts.resize(header.num_verts);
+    _navmesh_vert_cons.resize(header.num_verts);
+    _navmesh_triangles.resize(header.num_triangles);
+    _num_plates = header.num_plates;
+    delete[] _plate_ofsets;
+    delete[] _plate_vert_ofsets;
+    _plate_ofsets = new int[_num_plates + 1];
+    _plate_vert_ofsets = new int[_num_plates + 1];
+    _plate_components.resize(_num_plates);
+    _locator_w = header.locator_w;
+    _locator_h = header.locator_h;
+    _locator_buckets.resize(_locator_w * _locator_h);
+    _locator_entries.resize(header.num_locator_entries);
+
+    //the sections are listed with the destination arrays sized above
+    const char* read = (const char*)data + __cacheSectionOfset(sizeof(header));
+    for(auto& section: __cacheSections(header))
+    {
+      memcpy(section.first, read, section.second);
+      read += __cacheSectionOfset(section.second);
+    }
+    munmap(data, file_size);
+
+    __listTilePlates();
+    _dead_triangles = 0;
+    _buildOutlineIndex();
+    _buildHierarchy();
+    _resetSearchScratch();
+    ++_navmesh_generation;
+    _resumePathRequests();
+    return true;
   }
 
   void deleteNavMesh()
   {
+    _flushPathRequests();
+
     _navmesh_verts.clear();
+    _navmesh_vert_cons.clear();
     _navmesh_triangles.clear();
+    _plate_components.clear();
     _blocked_map = nullptr;
-    delete[] _status_map;
-    _status_map = nullptr;
+    _clearHierarchy();
+    _resetSearchScratch();
     delete[] _plate_ofsets;
     _plate_ofsets = nullptr;
     delete[] _plate_vert_ofsets;
     _plate_vert_ofsets = nullptr;
-    _nav_mesh_triangle_tree.destroy();
-    _nav_mesh_triangle_tree_inited = false;
+    _num_plates = 0;
+    _clearLocator();
+    _clearOutlineIndex();
+    _dead_triangles = 0;
+    ++_navmesh_generation;
+  }
+
+  template<typename T>
+  inline size_t __vectorBytes(const std::vector<T>& v)
+  {
+    return v.capacity() * sizeof(T);
+  }
+
+  void getNavMeshStats(NavMeshStats* stats)
+  {
+    stats->vertices = _navmesh_verts.size();
+    stats->triangles = _navmesh_triangles.size() - _dead_triangles;
+
+    //plates of carved tiles have no component, the id of a component is
+    //that of a plate which may have been carved since
+    std::vector<int> components;
+    for(int component: _plate_components)
+    {
+      if(component != -1)
+        components.push_back(component);
+    }
+    stats->plates = components.size();
+    std::sort(components.begin(), components.end());
+    stats->components = std::unique(components.begin(), components.end())
+      - components.begin();
+
+    size_t memory = __vectorBytes(_navmesh_verts)
+      + __vectorBytes(_navmesh_vert_cons) + __vectorBytes(_navmesh_triangles)
+      + __vectorBytes(_plate_components) + __vectorBytes(_locator_entries)
+      + __vectorBytes(_locator_buckets) + __vectorBytes(_outline_edges)
+      + __vectorBytes(_outline_buckets) + __vectorBytes(_cluster_of)
+      + __vectorBytes(_cluster_local) + __vectorBytes(_cluster_tri_ofsets)
+      + __vectorBytes(_cluster_tris) + __vectorBytes(_cluster_gate_ofsets)
+      + __vectorBytes(_gate_tris) + __vectorBytes(_gate_edge_ofsets)
+      + __vectorBytes(_gate_edges) + __vectorBytes(_gate_route_ofsets)
+      + __vectorBytes(_gate_routes) + __vectorBytes(_nav_tiles)
+      + __vectorBytes(_obstacles);
+    if(_plate_ofsets != nullptr)
+      memory += 2 * (_num_plates + 1) * sizeof(int);
+    for(auto& tile: _nav_tiles)
+      memory += __vectorBytes(tile.verts) + __vectorBytes(tile.vert_cons)
+        + __vectorBytes(tile.triangles) + __vectorBytes(tile.plate_ofsets)
+        + __vectorBytes(tile.plate_vert_ofsets) + __vectorBytes(tile.plates)
+        + __vectorBytes(tile.carved);
+    for(auto& obstacle: _obstacles)
+    {
+      if(obstacle)
+        memory += sizeof(__Obstacle) + __vectorBytes(obstacle->cells);
+    }
+    stats->memory = memory;
   }
 
   void displayNavMesh()
@@ -2,20 +2,15 @@
 #define WORLD_GEO_H_INCLUDED
 
 #include <stdint.h>
+
+#include <vector>
+#include <utility>
+
 #include "terrain.h"
 
-struct PathNode
+struct PathPoint
 {
   float x, y;
-  PathNode* next;
-
-  PathNode(float _x, float _y, PathNode* _next): x(_x), y(_y), next(_next){}
-  ~PathNode(){delete next;}
-
-  PathNode* advance();
-
-  void* operator new(size_t);
-  void operator delete(void*);
 };
 
 namespace WorldGeo
@@ -24,13 +19,91 @@ namespace WorldGeo
   constexpr size_t NMC_Plate_bitset_size = Terrain::blocked_map_max_size;
   using BlockedMapT = Terrain::BlockedMapT;
 
-  PathNode* findPath(float, float, float, float);
+  //paths are waypoint spans in a pooled store, named by handles, 0 is no
+  //path. the waypoints are in walking order and stay valid until the next
+  //path is created, the handle until the path is freed
+  typedef uint32_t PathHandle;
+
+  const PathPoint* getPath(PathHandle, unsigned*);
+  void freePath(PathHandle);
+
+  PathHandle findPath(float, float, float, float);
+  //only through gaps wide enough for a unit of the given radius, if any
+  PathHandle findPath(float, float, float, float, float);
+  //one destination for many units, the radius is of the largest
+  void findGroupPaths(const std::vector<std::pair<float, float>>&,
+                      float, float, float, std::vector<PathHandle>*);
+
+  //asynchronous path requests, searched on worker threads. requests pending
+  //while the navmesh changes are searched again on the new one, only
+  //deleting the navmesh drops them
+  typedef uint32_t PathRequestId;
+  typedef void(*PathReceiver)(void*, PathHandle);
+
+  PathRequestId requestPath(float, float, float, float, void*);
+  PathRequestId requestPath(float, float, float, float, float, void*);
+  void cancelPathRequest(PathRequestId);
+  void deliverPaths(unsigned, PathReceiver);
+
+  //flow fields for many units ordered to one point, shared per destination
+  //and radius. sampling gives a steering target, false once arrived or off
+  //the field
+  typedef uint32_t FlowFieldId;
+
+  FlowFieldId acquireFlowField(float, float, float, float, float);
+  void releaseFlowField(FlowFieldId);
+  //recomputes the fields made stale by navmesh changes. it has to run
+  //between a navmesh change and the next sampling, which only reads and
+  //can then run on several threads until the navmesh or the set of fields
+  //changes
+  void updateFlowFields();
+  bool sampleFlowField(FlowFieldId, float, float, int&, float*, float*);
   
   bool isBlocked(float, float);
   void pushIn(float&, float&, float, float);
+  //the int is a triangle hint kept per caller, -1 when unknown
+  bool isBlocked(float, float, int&);
+  void pushIn(float&, float&, float, float, int&);
+
+  //convex footprints in world units, in either winding, blocking the
+  //cells whose centers they cover. only the tiles under a footprint are
+  //triangulated again. 0 is no obstacle, there is none without a navmesh
+  //or on cells already under 255 obstacles
+  typedef uint32_t ObstacleId;
+
+  ObstacleId addObstacle(const PathPoint*, unsigned);
+  void removeObstacle(ObstacleId);
 
   void setupNavMesh(int, int, BlockedMapT*);
   void deleteNavMesh();
+  void updateNavMesh();
+  void invalidateNavMesh(int, int, int, int);
+  void invalidateNavMesh();
+
+  //binary navmesh cache, loading fails for files of another blocked map
+  bool saveNavMesh(const char*);
+  bool loadNavMesh(const char*, int, int, BlockedMapT*);
+
+  //sizes of the current navmesh without carved out triangles, memory
+  //counts the navmesh, its locator, search hierarchy and tile cache
+  struct NavMeshStats
+  {
+    unsigned vertices, triangles, plates, components;
+    size_t memory;
+  };
+
+  void getNavMeshStats(NavMeshStats*);
+
+#ifdef WORLD_GEO_BENCH
+  //runs random queries of a unit radius through the funnel and the one it
+  //replaced, returns the number of differing paths and the summed time of each
+  int compareFunnels(unsigned, int, float, double*, double*);
+  //times random triangle searches with the indexed heap and with the
+  //priority queue they use, returns the number of searches that found
+  //their triangle and the mean route length of the heap search relative
+  //to the other
+  int compareOpenLists(unsigned, int, double*, double*, double*);
+#endif
 
   void displayNavMesh();
   void removeNavMesh();